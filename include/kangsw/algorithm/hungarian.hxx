@@ -3,10 +3,29 @@
  */
 #pragma once
 #include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include <kangsw/container/ndarray.hxx>
 #include <kangsw/helpers/counter.hxx>
+#include <kangsw/helpers/for_each.hxx>
 #include <ranges>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KANGSW_HUNGARIAN_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace kangsw::algorithm {
 
 using hungarian_result_t = std::vector<size_t>;
@@ -23,246 +42,720 @@ auto is_roughly_zero(Ty_ value) {
 }
 
 /**
- * 보류 ...
- * Hungarian algorithm implementation class
+ * Row which could not be assigned to any column.
  */
-template <typename NumTy_, typename IsZero_>
-requires(std::is_integral_v<NumTy_> || std::is_floating_point_v<NumTy_>) //
-  struct hungarian_solver {
-    hungarian_result_t const&
-    operator()(ndarray<NumTy_, 2>&& distances, IsZero_&& is_zero) {
-        if (distances.dims()[0] != distances.dims()[1]) {
-            throw std::logic_error{"Given distance should be square"};
-        };
+constexpr size_t hungarian_unassigned = ~size_t{};
+
+/**
+ * Sparse cost matrix in CSR layout, for problems where most of pairs are impossible.
+ * Missing pairs are regarded as infinite cost, thus never assigned.
+ *
+ * @code{.cpp}
+    hungarian_sparse<float> costs{.num_cols = 3};
+    costs.push_row(), costs.push(0, 1.f), costs.push(2, 3.f); // row 0
+    costs.push_row(), costs.push(2, 1.f);                      // row 1
+ * @endcode
+ */
+template <typename NumTy_>
+struct hungarian_sparse {
+    size_t num_cols = 0;
+    std::vector<size_t> row_offsets = {0};
+    std::vector<size_t> cols = {};
+    std::vector<NumTy_> costs = {};
+
+    size_t num_rows() const { return row_offsets.size() - 1; }
+    void push_row() { row_offsets.push_back(cols.size()); }
+    void push(size_t col, NumTy_ cost) { cols.push_back(col), costs.push_back(cost), row_offsets.back() = cols.size(); }
+
+    void clear() {
+        row_offsets.assign(1, 0);
+        cols.clear(), costs.clear();
+    }
+};
+
+/**
+ * Non-owning view of dense cost matrix, which lets caller solve from its own storage.
+ * Strides are in elements; cost of (row, col) is data[row * row_stride + col * col_stride].
+ */
+template <typename NumTy_>
+struct hungarian_cost_view {
+    NumTy_ const* data = nullptr;
+    size_t num_rows = 0;
+    size_t num_cols = 0;
+    size_t row_stride = 0;
+    size_t col_stride = 1;
+
+    hungarian_cost_view() noexcept = default;
+    hungarian_cost_view(NumTy_ const* data, size_t num_rows, size_t num_cols) noexcept
+        : hungarian_cost_view(data, num_rows, num_cols, num_cols, 1) {}
+    hungarian_cost_view(NumTy_ const* data, size_t num_rows, size_t num_cols, size_t row_stride, size_t col_stride = 1) noexcept
+        : data(data), num_rows(num_rows), num_cols(num_cols), row_stride(row_stride), col_stride(col_stride) {}
+    hungarian_cost_view(ndarray<NumTy_, 2> const& arr) noexcept
+        : hungarian_cost_view(arr.data(), arr.dims()[0], arr.dims()[1]) {}
+    hungarian_cost_view(ndarray_view<NumTy_ const, 2> const& view) noexcept
+        : hungarian_cost_view(view.data(), view.dims()[0], view.dims()[1], view.strides()[0], view.strides()[1]) {}
+
+    NumTy_ operator()(size_t row, size_t col) const { return data[row * row_stride + col * col_stride]; }
+    auto transpose() const { return hungarian_cost_view{data, num_cols, num_rows, col_stride, row_stride}; }
+};
+
+/**
+ * Inner scan of shortest augmenting path, over columns [0, m) of a single row.
+ * Relaxes minv of every unused column with reduced cost (cost - u - v), records col0 as
+ * predecessor of the relaxed ones, then returns the smallest minv among unused columns
+ * with its index.
+ */
+template <typename CostTy_, typename PotTy_>
+std::pair<PotTy_, size_t> _hungarian_scan(
+  CostTy_ const* costs, PotTy_ u, PotTy_ const* v, PotTy_* minv, char const* used,
+  size_t* way, size_t col0, size_t m, size_t first = 0,
+  PotTy_ delta = std::numeric_limits<PotTy_>::max(), size_t col1 = 0) //
+{
+    for (size_t col = first; col < m; ++col) {
+        if (used[col]) { continue; }
 
-        // Reset solver
-        _distances = std::move(distances);
-        _len = _distances.dims()[0];
+        auto reduced = PotTy_(costs[col]) - u - v[col];
+        if (reduced < minv[col]) { minv[col] = reduced, way[col] = col0; }
+        if (minv[col] < delta) { delta = minv[col], col1 = col; }
+    }
 
-        _zeros.reshape(_distances.dims());
-        _line_zeros_rows.resize(_len);
-        _line_zeros_cols.resize(_len);
-        _line_cover_mask.reshape(_distances.dims());
+    return {delta, col1};
+}
 
-        _result.clear();
-        _result.resize(_len);
+#if defined(__AVX2__)
+inline std::pair<float, size_t> _hungarian_scan(
+  float const* costs, float u, float const* v, float* minv, char const* used,
+  size_t* way, size_t col0, size_t m) //
+{
+    auto const inf = _mm256_set1_ps(std::numeric_limits<float>::max());
+    auto const vu = _mm256_set1_ps(u);
+    auto best = inf;
+    auto best_idx = _mm256_setzero_si256();
+    auto idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    size_t col = 0;
+    for (; col + 8 <= m; col += 8, idx = _mm256_add_epi32(idx, _mm256_set1_epi32(8))) {
+        auto used8 = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(used + col)));
+        auto free = _mm256_castsi256_ps(_mm256_cmpeq_epi32(used8, _mm256_setzero_si256()));
+
+        auto reduced = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(costs + col), vu), _mm256_loadu_ps(v + col));
+        auto mv = _mm256_loadu_ps(minv + col);
+        auto relax = _mm256_and_ps(free, _mm256_cmp_ps(reduced, mv, _CMP_LT_OQ));
+        mv = _mm256_blendv_ps(mv, reduced, relax);
+        _mm256_storeu_ps(minv + col, mv);
+
+        // predecessor updates become rare as the tree grows
+        for (auto bits = unsigned(_mm256_movemask_ps(relax)); bits; bits &= bits - 1) {
+            way[col + std::countr_zero(bits)] = col0;
+        }
+
+        auto less = _mm256_cmp_ps(_mm256_blendv_ps(inf, mv, free), best, _CMP_LT_OQ);
+        best = _mm256_blendv_ps(best, mv, less);
+        best_idx = _mm256_blendv_epi8(best_idx, idx, _mm256_castps_si256(less));
+    }
 
-        // initial step
-        for (size_t row = 0; row < _len; ++row) { _row_zero(row); }
-        for (size_t col = 0; col < _len; ++col) { _col_zero(col); }
+    alignas(32) float values[8];
+    alignas(32) int32_t indexes[8];
+    _mm256_store_ps(values, best), _mm256_store_si256(reinterpret_cast<__m256i*>(indexes), best_idx);
 
-        while (!_is_optimal(is_zero)) {
-            _step1();
+    auto delta = std::numeric_limits<float>::max();
+    size_t col1 = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+        if (values[lane] < delta || (values[lane] == delta && size_t(indexes[lane]) < col1)) {
+            delta = values[lane], col1 = indexes[lane];
         }
+    }
+
+    return _hungarian_scan<float, float>(costs, u, v, minv, used, way, col0, m, col, delta, col1);
+}
+
+inline std::pair<double, size_t> _hungarian_scan(
+  double const* costs, double u, double const* v, double* minv, char const* used,
+  size_t* way, size_t col0, size_t m) //
+{
+    auto const inf = _mm256_set1_pd(std::numeric_limits<double>::max());
+    auto const vu = _mm256_set1_pd(u);
+    auto best = inf;
+    auto best_idx = _mm256_setzero_si256();
+    auto idx = _mm256_setr_epi64x(0, 1, 2, 3);
+
+    size_t col = 0;
+    for (; col + 4 <= m; col += 4, idx = _mm256_add_epi64(idx, _mm256_set1_epi64x(4))) {
+        int32_t used4;
+        std::memcpy(&used4, used + col, sizeof used4);
+        auto used_mask = _mm256_cvtepi8_epi64(_mm_cvtsi32_si128(used4));
+        auto free = _mm256_castsi256_pd(_mm256_cmpeq_epi64(used_mask, _mm256_setzero_si256()));
+
+        auto reduced = _mm256_sub_pd(_mm256_sub_pd(_mm256_loadu_pd(costs + col), vu), _mm256_loadu_pd(v + col));
+        auto mv = _mm256_loadu_pd(minv + col);
+        auto relax = _mm256_and_pd(free, _mm256_cmp_pd(reduced, mv, _CMP_LT_OQ));
+        mv = _mm256_blendv_pd(mv, reduced, relax);
+        _mm256_storeu_pd(minv + col, mv);
+
+        for (auto bits = unsigned(_mm256_movemask_pd(relax)); bits; bits &= bits - 1) {
+            way[col + std::countr_zero(bits)] = col0;
+        }
+
+        auto less = _mm256_cmp_pd(_mm256_blendv_pd(inf, mv, free), best, _CMP_LT_OQ);
+        best = _mm256_blendv_pd(best, mv, less);
+        best_idx = _mm256_blendv_epi8(best_idx, idx, _mm256_castpd_si256(less));
+    }
+
+    alignas(32) double values[4];
+    alignas(32) int64_t indexes[4];
+    _mm256_store_pd(values, best), _mm256_store_si256(reinterpret_cast<__m256i*>(indexes), best_idx);
 
-        _result.resize(_len);
+    auto delta = std::numeric_limits<double>::max();
+    size_t col1 = 0;
+    for (int lane = 0; lane < 4; ++lane) {
+        if (values[lane] < delta || (values[lane] == delta && size_t(indexes[lane]) < col1)) {
+            delta = values[lane], col1 = indexes[lane];
+        }
+    }
+
+    return _hungarian_scan<double, double>(costs, u, v, minv, used, way, col0, m, col, delta, col1);
+}
+#elif defined(KANGSW_HUNGARIAN_SSE2)
+// SSE2 is baseline of x86-64, thus this is the kernel of default builds; it lacks blendv.
+inline __m128 _sse_select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline __m128d _sse_select(__m128d mask, __m128d a, __m128d b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+inline __m128i _sse_select(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+inline std::pair<float, size_t> _hungarian_scan(
+  float const* costs, float u, float const* v, float* minv, char const* used,
+  size_t* way, size_t col0, size_t m) //
+{
+    auto const inf = _mm_set1_ps(std::numeric_limits<float>::max());
+    auto const vu = _mm_set1_ps(u);
+    auto best = inf;
+    auto best_idx = _mm_setzero_si128();
+    auto idx = _mm_setr_epi32(0, 1, 2, 3);
+
+    size_t col = 0;
+    for (; col + 4 <= m; col += 4, idx = _mm_add_epi32(idx, _mm_set1_epi32(4))) {
+        int32_t used4;
+        std::memcpy(&used4, used + col, sizeof used4);
+        auto free8 = _mm_cmpeq_epi8(_mm_cvtsi32_si128(used4), _mm_setzero_si128());
+        free8 = _mm_unpacklo_epi8(free8, free8);
+        auto free = _mm_castsi128_ps(_mm_unpacklo_epi16(free8, free8));
+
+        auto reduced = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(costs + col), vu), _mm_loadu_ps(v + col));
+        auto mv = _mm_loadu_ps(minv + col);
+        auto relax = _mm_and_ps(free, _mm_cmplt_ps(reduced, mv));
+        mv = _sse_select(relax, reduced, mv);
+        _mm_storeu_ps(minv + col, mv);
+
+        for (auto bits = unsigned(_mm_movemask_ps(relax)); bits; bits &= bits - 1) {
+            way[col + std::countr_zero(bits)] = col0;
+        }
+
+        auto less = _mm_cmplt_ps(_sse_select(free, mv, inf), best);
+        best = _sse_select(less, mv, best);
+        best_idx = _sse_select(_mm_castps_si128(less), idx, best_idx);
+    }
+
+    alignas(16) float values[4];
+    alignas(16) int32_t indexes[4];
+    _mm_store_ps(values, best), _mm_store_si128(reinterpret_cast<__m128i*>(indexes), best_idx);
+
+    auto delta = std::numeric_limits<float>::max();
+    size_t col1 = 0;
+    for (int lane = 0; lane < 4; ++lane) {
+        if (values[lane] < delta || (values[lane] == delta && size_t(indexes[lane]) < col1)) {
+            delta = values[lane], col1 = indexes[lane];
+        }
+    }
+
+    return _hungarian_scan<float, float>(costs, u, v, minv, used, way, col0, m, col, delta, col1);
+}
+
+inline std::pair<double, size_t> _hungarian_scan(
+  double const* costs, double u, double const* v, double* minv, char const* used,
+  size_t* way, size_t col0, size_t m) //
+{
+    auto const inf = _mm_set1_pd(std::numeric_limits<double>::max());
+    auto const vu = _mm_set1_pd(u);
+    auto best = inf;
+    auto best_idx = _mm_setzero_si128();
+    auto idx = _mm_set_epi64x(1, 0);
+
+    size_t col = 0;
+    for (; col + 2 <= m; col += 2, idx = _mm_add_epi64(idx, _mm_set1_epi64x(2))) {
+        uint16_t used2;
+        std::memcpy(&used2, used + col, sizeof used2);
+        auto free8 = _mm_cmpeq_epi8(_mm_cvtsi32_si128(used2), _mm_setzero_si128());
+        free8 = _mm_unpacklo_epi8(free8, free8);
+        free8 = _mm_unpacklo_epi16(free8, free8);
+        auto free = _mm_castsi128_pd(_mm_unpacklo_epi32(free8, free8));
+
+        auto reduced = _mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(costs + col), vu), _mm_loadu_pd(v + col));
+        auto mv = _mm_loadu_pd(minv + col);
+        auto relax = _mm_and_pd(free, _mm_cmplt_pd(reduced, mv));
+        mv = _sse_select(relax, reduced, mv);
+        _mm_storeu_pd(minv + col, mv);
+
+        for (auto bits = unsigned(_mm_movemask_pd(relax)); bits; bits &= bits - 1) {
+            way[col + std::countr_zero(bits)] = col0;
+        }
+
+        auto less = _mm_cmplt_pd(_sse_select(free, mv, inf), best);
+        best = _sse_select(less, mv, best);
+        best_idx = _sse_select(_mm_castpd_si128(less), idx, best_idx);
+    }
+
+    alignas(16) double values[2];
+    alignas(16) int64_t indexes[2];
+    _mm_store_pd(values, best), _mm_store_si128(reinterpret_cast<__m128i*>(indexes), best_idx);
+
+    auto delta = std::numeric_limits<double>::max();
+    size_t col1 = 0;
+    for (int lane = 0; lane < 2; ++lane) {
+        if (values[lane] < delta || (values[lane] == delta && size_t(indexes[lane]) < col1)) {
+            delta = values[lane], col1 = indexes[lane];
+        }
+    }
+
+    return _hungarian_scan<double, double>(costs, u, v, minv, used, way, col0, m, col, delta, col1);
+}
+#endif
+
+enum class hungarian_method {
+    shortest_path, // exact, O(n^2 m)
+    auction,       // epsilon-scaling auction; fast on large, nearly square problems
+};
+
+struct hungarian_options {
+    hungarian_method method = hungarian_method::shortest_path;
+
+    // Epsilon is divided by this on every auction scaling phase.
+    double auction_scaling = 5;
+
+    // Floating-point auction stops when total cost is within (tolerance * cost range) from
+    //optimum. Integral costs are always solved exactly.
+    double auction_tolerance = 1e-6;
+};
+
+/**
+ * Hungarian algorithm implementation class
+ * Finds shortest augmenting path for each row while maintaining row/column potentials,
+ * which takes O(n^2 m) time and O(n + m) memory besides the distance matrix, for n <= m.
+ * If there are more rows than columns, solves transposed problem instead.
+ *
+ * Sparse problems are solved by Dijkstra over candidate edges only. Each row also has
+ * its own virtual column with very large cost, which lets the row be unassigned.
+ *
+ * Every buffer of the solver only grows, thus keeping single solver instance alive and
+ * calling it repeatedly does not allocate once it has seen the largest problem.
+ *
+ * Dense problems can be solved with auction algorithm instead, by options.method. Rows
+ * are padded with zero-cost virtual rows to make the problem square.
+ */
+template <typename NumTy_>
+requires(std::is_integral_v<NumTy_> || std::is_floating_point_v<NumTy_>) //
+  struct hungarian_solver {
+    // Reduced costs are calculated from potentials, which should be signed and wide enough.
+    using potential_type = std::conditional_t<std::is_floating_point_v<NumTy_>, NumTy_, int64_t>;
 
-        // fill zeros again
-        for (auto& idx : counter(_distances.dims())) {
-            _zeros[idx] = is_zero(_distances[idx]);
+    hungarian_result_t const&
+    operator()(hungarian_cost_view<NumTy_> costs) {
+        auto const transposed = costs.num_rows > costs.num_cols;
+        if (transposed) { costs = costs.transpose(); }
+
+        // Inner loop scans a row contiguously; pack the matrix into workspace otherwise.
+        if (costs.col_stride != 1) {
+            _packed.resize(costs.num_rows * costs.num_cols);
+            for (size_t row = 0; row < costs.num_rows; ++row) {
+                for (size_t col = 0; col < costs.num_cols; ++col) { _packed[row * costs.num_cols + col] = costs(row, col); }
+            }
+            costs = {_packed.data(), costs.num_rows, costs.num_cols};
         }
 
-        _occupation.clear();
-        _occupation.resize(_len);
-        _find_optimal();
+        if (options.method == hungarian_method::auction) { _solve_auction(costs); }
+        else { _solve_dense(costs); }
+        _collect_dense_result(costs.num_rows, costs.num_cols, transposed);
+        return _result;
+    }
+
+    hungarian_result_t const&
+    operator()(ndarray<NumTy_, 2> const& distances) {
+        return (*this)(hungarian_cost_view<NumTy_>{distances});
+    }
+
+    hungarian_result_t const&
+    operator()(hungarian_sparse<NumTy_> const& costs) {
+        _validate_sparse(costs);
+        _solve_sparse(costs);
         return _result;
     }
 
 private:
-    enum class line_t {
-        none,
-        row,
-        col
-    };
-
-    auto _row_subtr(size_t row, NumTy_ val) {
-        for (size_t i = 0; i < _len; i++) { _distances(row, i) -= val; }
-    };
-    auto _col_subtr(size_t col, NumTy_ val) {
-        for (size_t i = 0; i < _len; i++) { _distances(i, col) -= val; }
-    };
-    auto _row_min(size_t row) const {
-        NumTy_ min = std::numeric_limits<NumTy_>::max();
-        for (size_t i = 0; i < _len; i++) { min = std::min(min, _distances(row, i)); }
-        return min;
-    };
-    auto _col_min(size_t col) const {
-        NumTy_ min = std::numeric_limits<NumTy_>::max();
-        for (size_t i = 0; i < _len; i++) { min = std::min(min, _distances(i, col)); }
-        return min;
-    };
-    auto _col_zero(size_t col) {
-        return _col_subtr(col, _col_min(col));
-    };
-    auto _row_zero(size_t row) {
-        return _row_subtr(row, _row_min(row));
-    };
-    auto _col_sum(size_t col) const {
-        NumTy_ sum = {};
-        for (size_t i = 0; i < _len; i++) { sum += _distances(i, col); }
-        return sum;
-    };
-    auto _row_sum(size_t row) const {
-        NumTy_ sum = {};
-        for (size_t i = 0; i < _len; i++) { sum += _distances(row, i); }
-        return sum;
-    };
-
-    // optimal check
-    // check if we can erase all zeros GE than 'len' lines
-    bool _is_optimal(IsZero_& is_zero) {
-        // fill zeros
-        for (auto& idx : counter(_distances.dims())) {
-            _zeros[idx] = is_zero(_distances[idx]);
+    // Columns are 1-based in below arrays, and column 0 is a virtual column where each
+    //new row starts searching from.
+    void _solve_dense(hungarian_cost_view<NumTy_> const& distances) {
+        constexpr auto inf = std::numeric_limits<potential_type>::max();
+        auto const n = distances.num_rows;
+        auto const m = distances.num_cols;
+
+        _row_potential.assign(n + 1, 0);
+        _col_potential.assign(m + 1, 0);
+        _col_match.assign(m + 1, 0);
+        _col_way.assign(m + 1, 0);
+        _col_minv.resize(m + 1);
+        _col_used.resize(m + 1);
+
+        for (size_t row = 1; row <= n; ++row) {
+            _col_match[0] = row;
+            size_t col0 = 0;
+            std::fill(_col_minv.begin(), _col_minv.end(), inf);
+            std::fill(_col_used.begin(), _col_used.end(), false);
+
+            // grow alternating tree until it reaches a free column
+            _touched.clear();
+            do {
+                _col_used[col0] = true;
+                _touched.push_back(col0);
+
+                auto const row0 = _col_match[col0];
+                auto const u = _row_potential[row0];
+                auto const* costs = distances.data + (row0 - 1) * distances.row_stride;
+
+                auto [delta, col1] = _hungarian_scan(
+                  costs, u, &_col_potential[1], &_col_minv[1], &_col_used[1], &_col_way[1], col0, m);
+
+                for (auto col : _touched) {
+                    _row_potential[_col_match[col]] += delta;
+                    _col_potential[col] -= delta;
+                }
+
+                // minv of used columns is never read again, thus subtract from every column
+                //without branch, which compiler vectorizes.
+                auto* minv = &_col_minv[1];
+                for (size_t col = 0; col < m; ++col) { minv[col] -= delta; }
+
+                col0 = col1 + 1;
+            } while (_col_match[col0] != 0);
+
+            // flip matches along the augmenting path
+            do {
+                auto col1 = _col_way[col0];
+                _col_match[col0] = _col_match[col1];
+                col0 = col1;
+            } while (col0 != 0);
         }
+    }
 
-        // calculate each line's containing zero count
-        std::fill(_line_zeros_rows.begin(), _line_zeros_rows.end(), 0);
-        std::fill(_line_zeros_cols.begin(), _line_zeros_cols.end(), 0);
+    // Forward auction maximizing benefit, which is negated cost. Integral costs are
+    //multiplied by (m + 1), then final epsilon of 1 guarantees optimality.
+    void _solve_auction(hungarian_cost_view<NumTy_> const& distances) {
+        constexpr auto npos = hungarian_unassigned;
+        constexpr bool exact = std::is_integral_v<NumTy_>;
+        auto const n = distances.num_rows;
+        auto const m = distances.num_cols;
+        auto const scale = exact ? potential_type(m + 1) : potential_type(1);
+
+        auto benefit = [&](size_t row, size_t col) -> potential_type {
+            return row < n ? -potential_type(distances.data[row * distances.row_stride + col]) * scale : 0;
+        };
 
-        for (size_t idx = 0; idx < _len; idx++) {
-            for (size_t row = idx, col = 0; col < _len; col++) {
-                _line_zeros_rows[idx] += _zeros(row, col);
-            }
-            for (size_t col = idx, row = 0; row < _len; row++) {
-                _line_zeros_cols[idx] += _zeros(row, col);
+        potential_type lo = n < m ? 0 : std::numeric_limits<potential_type>::max();
+        potential_type hi = n < m ? 0 : std::numeric_limits<potential_type>::lowest();
+        for (size_t row = 0; row < n; ++row) {
+            for (size_t col = 0; col < m; ++col) {
+                auto value = benefit(row, col);
+                lo = std::min(lo, value), hi = std::max(hi, value);
             }
         }
 
-        // erase maximums from line_zeros
-        _lines.clear();
-        for (;;) {
-            auto it_rmax = std::ranges::max_element(_line_zeros_rows);
-            auto it_cmax = std::ranges::max_element(_line_zeros_cols);
-
-            // erase given zeros covered by given line.
-            // dethermines whether it is row or column, by comparing maximum values of rows/cols
-            if (*it_rmax > *it_cmax) {
-                auto row = it_rmax - _line_zeros_rows.begin();
-                _lines.emplace_back(line_t::row, row);
-
-                *it_rmax = 0;
-                for (size_t col = 0; col < _len; ++col) {
-                    if (auto& target = _zeros(row, col)) {
-                        target = false;
-                        _line_zeros_cols[col] -= 1;
-                    }
+        auto const range = m ? hi - lo : 0;
+        potential_type final_eps = 1;
+        if constexpr (!exact) {
+            final_eps = std::max<potential_type>(
+              range * potential_type(options.auction_tolerance) / potential_type(m),
+              range * 16 * std::numeric_limits<potential_type>::epsilon());
+            if (final_eps <= 0) { final_eps = 1; }
+        }
+
+        auto& prices = _col_potential;
+        auto& col_owner = _col_way;
+        auto& unassigned = _touched;
+        prices.assign(m, 0);
+        _row_match.resize(m);
+        col_owner.resize(m);
+
+        for (auto eps = std::max<potential_type>(final_eps, potential_type(range / options.auction_scaling));;) {
+            std::fill(_row_match.begin(), _row_match.end(), npos);
+            std::fill(col_owner.begin(), col_owner.end(), npos);
+            unassigned.resize(m);
+            std::iota(unassigned.rbegin(), unassigned.rend(), size_t{});
+
+            while (!unassigned.empty()) {
+                auto const row = unassigned.back();
+                unassigned.pop_back();
+
+                auto best = std::numeric_limits<potential_type>::lowest(), second = best;
+                size_t best_col = 0;
+                for (size_t col = 0; col < m; ++col) {
+                    auto value = benefit(row, col) - prices[col];
+                    if (value > best) { second = best, best = value, best_col = col; }
+                    else if (value > second) { second = value; }
                 }
-            }
-            else {
-                auto col = it_cmax - _line_zeros_cols.begin();
-                _lines.emplace_back(line_t::col, col);
-
-                *it_cmax = 0;
-                for (size_t row = 0; row < _len; ++row) {
-                    if (auto& target = _zeros(row, col)) {
-                        target = false;
-                        _line_zeros_rows[row] -= 1;
-                    }
+                if (m == 1) { second = best; }
+
+                prices[best_col] += best - second + eps;
+                if (auto prev = col_owner[best_col]; prev != npos) {
+                    _row_match[prev] = npos;
+                    unassigned.push_back(prev);
                 }
+                col_owner[best_col] = row, _row_match[row] = best_col;
             }
 
-            // check if there's no zero.
-            if (
-              std::ranges::find(_line_zeros_rows, 1) == _line_zeros_rows.end()
-              && std::ranges::find(_line_zeros_cols, 1) == _line_zeros_cols.end()) {
-                break;
-            }
+            if (eps <= final_eps) { break; }
+            eps = std::max<potential_type>(final_eps, potential_type(eps / options.auction_scaling));
         }
 
-        return _lines.size() >= _len;
+        _col_match.assign(m + 1, 0);
+        for (size_t row = 0; row < n; ++row) { _col_match[_row_match[row] + 1] = row + 1; }
     }
 
-    // modifies distance matrix
-    void _step1() {
-        // create line-covering mask
-        std::ranges::fill(_line_cover_mask, 0);
-        for (auto& line : _lines) {
-            if (line.first == line_t::row) {
-                for (auto col : counter(_len)) { ++_line_cover_mask(line.second, col); }
-            }
-            else {
-                for (auto row : counter(_len)) { ++_line_cover_mask(row, line.second); }
-            }
+    void _collect_dense_result(size_t n, size_t m, bool transposed) {
+        _result.assign(transposed ? m : n, hungarian_unassigned);
+        for (size_t col = 1; col <= m; ++col) {
+            if (_col_match[col] == 0) { continue; }
+            if (transposed) { _result[col - 1] = _col_match[col] - 1; }
+            else { _result[_col_match[col] - 1] = col - 1; }
+        }
+    }
+
+    // Malformed CSR input should throw here, rather than indexing out of column arrays.
+    static void _validate_sparse(hungarian_sparse<NumTy_> const& sp) {
+        auto const& offsets = sp.row_offsets;
+        if (offsets.empty() || offsets.front() != 0 || offsets.back() != sp.cols.size()) {
+            throw std::invalid_argument("row offsets don't cover column indices");
+        }
+        if (sp.costs.size() != sp.cols.size()) { throw std::invalid_argument("costs and column indices differ in length"); }
+        if (!std::ranges::is_sorted(offsets)) { throw std::invalid_argument("row offsets are not ascending"); }
+        if (std::ranges::any_of(sp.cols, [m = sp.num_cols](size_t col) { return col >= m; })) {
+            throw std::invalid_argument("column index out of range");
+        }
+    }
+
+    // Columns [m, m + n) are virtual columns; row i has single edge to column m + i.
+    void _solve_sparse(hungarian_sparse<NumTy_> const& sp) {
+        constexpr auto npos = hungarian_unassigned;
+        auto const n = sp.num_rows();
+        auto const m = sp.num_cols;
+
+        // Virtual edge should cost more than any difference of real assignments.
+        potential_type lo = 0, hi = 0;
+        if (!sp.costs.empty()) {
+            auto [min_it, max_it] = std::ranges::minmax_element(sp.costs);
+            lo = *min_it, hi = *max_it;
         }
+        potential_type const unassign_cost = (hi - lo + 1) * potential_type(std::min(n, m) + 1) + hi;
 
-        // find minimum from line-covering mask
-        auto min_value = std::numeric_limits<NumTy_>::max();
-        for (auto index : counter(_distances.dims())) {
-            if (_line_cover_mask[index] == 0) {
-                min_value = std::min(_distances[index], min_value);
+        auto for_each_edge = [&](size_t row, auto&& fn) {
+            for (auto i = sp.row_offsets[row]; i < sp.row_offsets[row + 1]; ++i) {
+                fn(sp.cols[i], potential_type(sp.costs[i]));
             }
+            fn(m + row, unassign_cost);
+        };
+
+        _row_potential.resize(n);
+        _row_match.assign(n, npos);
+        _col_potential.assign(m + n, 0);
+        _col_match.assign(m + n, npos);
+        _col_way.resize(m + n);
+        _col_minv.resize(m + n);
+        _col_used.assign(m + n, 0);
+
+        // Initial potentials keep every reduced cost non-negative
+        for (size_t row = 0; row < n; ++row) {
+            auto& u = _row_potential[row] = unassign_cost;
+            for_each_edge(row, [&](size_t, potential_type cost) { u = std::min(u, cost); });
         }
 
-        // discount minimum value from non-line-covered area,
-        //and increase double-covered area's value
-        for (auto index : counter(_distances.dims())) {
-            if (_line_cover_mask[index] == 0) {
-                _distances[index] -= min_value;
+        enum : char { unseen,
+                      queued,
+                      settled };
+
+        for (size_t source = 0; source < n; ++source) {
+            _heap.clear(), _touched.clear();
+
+            auto relax = [&](size_t row, potential_type base) {
+                auto const u = _row_potential[row];
+                for_each_edge(row, [&](size_t col, potential_type cost) {
+                    if (_col_used[col] == settled) { return; }
+
+                    auto dist = base + cost - u - _col_potential[col];
+                    if (_col_used[col] == unseen) { _touched.push_back(col); }
+                    else if (_col_minv[col] <= dist) { return; }
+
+                    _col_used[col] = queued;
+                    _col_minv[col] = dist, _col_way[col] = row;
+                    _heap.emplace_back(dist, col);
+                    std::ranges::push_heap(_heap, std::greater<>{});
+                });
+            };
+
+            // Dijkstra until the nearest free column is settled; always succeeds thanks to virtual columns.
+            relax(source, 0);
+            size_t free_col;
+            potential_type free_dist;
+            for (;;) {
+                std::ranges::pop_heap(_heap, std::greater<>{});
+                auto [dist, col] = _heap.back();
+                _heap.pop_back();
+                if (_col_used[col] == settled || dist > _col_minv[col]) { continue; }
+
+                _col_used[col] = settled;
+                if (_col_match[col] == npos) {
+                    free_col = col, free_dist = dist;
+                    break;
+                }
+
+                relax(_col_match[col], dist);
             }
-            else if (_line_cover_mask[index] == 2) {
-                _distances[index] += min_value;
+
+            // Update potentials of visited nodes, which keeps reduced costs non-negative and
+            //makes every edge on the shortest path tight.
+            _row_potential[source] += free_dist;
+            for (auto col : _touched) {
+                if (_col_used[col] == settled && col != free_col) {
+                    auto diff = free_dist - _col_minv[col];
+                    _col_potential[col] -= diff;
+                    _row_potential[_col_match[col]] += diff;
+                }
+                _col_used[col] = unseen;
             }
-        }
-    }
 
-    // generate optimal result
-    bool _find_optimal(size_t row = 0) {
-        for (size_t col = 0; col < _len; col++) {
-            if (!_zeros(row, col)) { continue; }
-            if (_occupation[col]) { continue; }
+            // flip matches along the augmenting path
+            for (auto col = free_col;;) {
+                auto row = _col_way[col];
+                auto next_col = _row_match[row];
+                _col_match[col] = row, _row_match[row] = col;
 
-            _occupation[col] = true;
-            if (row + 1 == _len || _find_optimal(row + 1)) {
-                _result[row] = col;
-                return true;
+                if (row == source) { break; }
+                col = next_col;
             }
-            _occupation[col] = false;
         }
 
-        return false;
+        _result.resize(n);
+        for (size_t row = 0; row < n; ++row) {
+            _result[row] = _row_match[row] < m ? _row_match[row] : npos;
+        }
     }
 
-private:
-    struct _search_stack_entity {
-        size_t row;
-        size_t col;
-    };
+public:
+    hungarian_options options;
 
 private:
     hungarian_result_t _result;
-    std::vector<_search_stack_entity> _search_stack;
-    ndarray<NumTy_, 2> _distances;
-    ndarray<int8_t, 2> _zeros;
-    std::vector<size_t> _line_zeros_rows;
-    std::vector<size_t> _line_zeros_cols;
-    std::vector<std::pair<line_t, size_t>> _lines;
-    ndarray<int8_t, 2> _line_cover_mask;
-    std::vector<bool> _occupation;
-    size_t _len;
+    std::vector<NumTy_> _packed;
+    std::vector<potential_type> _row_potential;
+    std::vector<potential_type> _col_potential;
+    std::vector<potential_type> _col_minv;
+    std::vector<size_t> _row_match;
+    std::vector<size_t> _col_match;
+    std::vector<size_t> _col_way;
+    std::vector<char> _col_used;
+    std::vector<size_t> _touched;
+    std::vector<std::pair<potential_type, size_t>> _heap;
 };
 
 /**
  * Calculate hungarian pairs 
+ * Returns assigned column for each row, or hungarian_unassigned if there are more rows than columns.
+ * is_zero is kept for compatibility; potentials are compared exactly, thus no tolerance is needed.
+ *
+ * Creates a solver for every call; keep a hungarian_solver to reuse its buffers instead.
  */
 template <typename NumTy_, typename IsZero_ = bool (&)(NumTy_)>
 requires std::is_integral_v<NumTy_> || std::is_floating_point_v<NumTy_>
-auto hungarian(ndarray<NumTy_, 2>&& distances, IsZero_&& is_zero = is_roughly_zero<NumTy_>) -> hungarian_result_t //
+auto hungarian(ndarray<NumTy_, 2>&& distances, IsZero_&& = is_roughly_zero<NumTy_>) -> hungarian_result_t //
+{
+    return hungarian_solver<NumTy_>{}(distances);
+}
+
+template <typename NumTy_>
+requires std::is_integral_v<NumTy_> || std::is_floating_point_v<NumTy_>
+auto hungarian(hungarian_cost_view<NumTy_> costs) -> hungarian_result_t //
 {
-    return hungarian_solver<NumTy_, IsZero_>{}(std::move(distances), std::move(is_zero));
+    return hungarian_solver<NumTy_>{}(costs);
+}
+
+/**
+ * Calculate hungarian pairs from sparse candidates.
+ * Rows which cannot be assigned are reported as hungarian_unassigned. Maximizes number of
+ * assigned rows first, then minimizes total cost among them.
+ */
+template <typename NumTy_>
+requires std::is_integral_v<NumTy_> || std::is_floating_point_v<NumTy_>
+auto hungarian(hungarian_sparse<NumTy_> const& costs) -> hungarian_result_t //
+{
+    return hungarian_solver<NumTy_>{}(costs);
+}
+
+template <typename Ty_>
+struct _hungarian_cost_type;
+
+template <typename NumTy_>
+struct _hungarian_cost_type<ndarray<NumTy_, 2>> { using type = NumTy_; };
+
+template <typename NumTy_>
+struct _hungarian_cost_type<hungarian_cost_view<NumTy_>> { using type = NumTy_; };
+
+/**
+ * Solves many independent problems in parallel, each of which is ndarray or hungarian_cost_view.
+ * Results are written contiguously into out in order of problems, thus out should hold total
+ * number of rows at least. Each thread keeps its own solver, which survives between calls.
+ *
+ * @return Number of elements written to out
+ */
+template <typename ExPo_, typename Range_>
+requires std::ranges::random_access_range<Range_>
+size_t hungarian_batch(
+  ExPo_&& policy,
+  Range_ const& problems,
+  std::span<size_t> out,
+  hungarian_options const& options = {},
+  size_t num_partitions = std::thread::hardware_concurrency()) //
+{
+    using num_type = typename _hungarian_cost_type<std::ranges::range_value_t<Range_>>::type;
+    auto const num_problems = std::size(problems);
+    if (num_problems == 0) { return 0; }
+
+    std::vector<size_t> offsets(num_problems + 1);
+    for (size_t index = 0; auto& problem : problems) {
+        offsets[index + 1] = offsets[index] + hungarian_cost_view<num_type>{problem}.num_rows;
+        ++index;
+    }
+    if (offsets.back() > out.size()) { throw std::invalid_argument("output buffer is too small"); }
+
+    iota<size_t> indexes(num_problems);
+    for_each_partition(
+      std::forward<ExPo_>(policy), indexes.begin(), indexes.end(),
+      [&](size_t index) {
+          thread_local hungarian_solver<num_type> solver;
+          solver.options = options;
+
+          auto& result = solver(hungarian_cost_view<num_type>{std::ranges::begin(problems)[index]});
+          std::ranges::copy(result, out.begin() + offsets[index]);
+      },
+      std::max<size_t>(1, num_partitions));
+
+    return offsets.back();
 }
 
 /**
- * 
+ * Calculate hungarian pairs between two ranges, with given distance function.
+ * Sizes of two ranges may differ.
  */
-template <typename RangeA_, typename RangeB_, typename DistFn_, typename IsZero_>
-requires std::is_arithmetic_v<typename std::ranges::range_value_t<RangeA_>> //
-  && std::is_arithmetic_v<typename std::ranges::range_value_t<RangeB_>>
+template <typename RangeA_, typename RangeB_, typename DistFn_, typename IsZero_ = std::nullptr_t>
 auto hungarian(
   RangeA_ const& range_a,
   RangeB_ const& range_b,
   DistFn_&& calc,
-  IsZero_&& is_zero = is_roughly_zero<std::invoke_result_t<DistFn_, std::ranges::range_value_t<RangeA_>, std::ranges::range_value_t<RangeA_>>>) -> hungarian_result_t //
+  IsZero_&& = {}) -> hungarian_result_t //
 {
     auto const num_rows = std::size(range_a);
     auto const num_cols = std::size(range_b);
@@ -284,6 +777,6 @@ auto hungarian(
         n_r++;
     }
 
-    return hungarian(std::move(dists), std::move(is_zero));
+    return hungarian(std::move(dists));
 }
 } // namespace kangsw::algorithm
\ No newline at end of file
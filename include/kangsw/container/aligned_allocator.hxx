@@ -0,0 +1,76 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace kangsw::inline containers {
+/**
+ * Tag to skip value-initialization of trivial elements on reshape or resize
+ */
+struct uninitialized_t {};
+constexpr uninitialized_t uninitialized{};
+
+/**
+ * Allocator which aligns every allocation by Align_ bytes.
+ * 64 fits both of cache line and AVX-512 register; use larger value like 2MB to let the
+ * kernel back the memory with huge pages.
+ */
+template <typename Ty_, size_t Align_ = 64>
+struct aligned_allocator {
+    static_assert(std::has_single_bit(Align_), "alignment should be power of two");
+
+    using value_type = Ty_;
+    using is_always_equal = std::true_type;
+    enum : size_t { alignment = std::max(Align_, alignof(Ty_)) };
+
+    template <typename OTy_>
+    struct rebind { using other = aligned_allocator<OTy_, Align_>; };
+
+    aligned_allocator() noexcept = default;
+    template <typename OTy_>
+    aligned_allocator(aligned_allocator<OTy_, Align_> const&) noexcept {}
+
+    Ty_* allocate(size_t n) {
+        return static_cast<Ty_*>(::operator new(n * sizeof(Ty_), std::align_val_t{alignment}));
+    }
+
+    void deallocate(Ty_* p, size_t n) noexcept {
+        ::operator delete(p, n * sizeof(Ty_), std::align_val_t{alignment});
+    }
+
+    template <typename OTy_>
+    bool operator==(aligned_allocator<OTy_, Align_> const&) const noexcept { return true; }
+};
+
+/**
+ * Adapts an allocator to leave trivially default constructible elements uninitialized, when
+ * constructed without argument. Thus resizing a vector of such type does not touch the memory.
+ */
+template <typename Alloc_>
+struct default_init_allocator : Alloc_ {
+    using _traits = std::allocator_traits<Alloc_>;
+
+    template <typename OTy_>
+    struct rebind { using other = default_init_allocator<typename _traits::template rebind_alloc<OTy_>>; };
+
+    default_init_allocator() noexcept(std::is_nothrow_default_constructible_v<Alloc_>) = default;
+    default_init_allocator(Alloc_ const& alloc) noexcept : Alloc_(alloc) {}
+    template <typename OAlloc_>
+    default_init_allocator(default_init_allocator<OAlloc_> const& other) noexcept
+        : Alloc_(static_cast<OAlloc_ const&>(other)) {}
+
+    template <typename OTy_>
+    void construct(OTy_* p) noexcept(std::is_nothrow_default_constructible_v<OTy_>) {
+        if constexpr (std::is_trivially_default_constructible_v<OTy_>) { ::new (static_cast<void*>(p)) OTy_; }
+        else { _traits::construct(static_cast<Alloc_&>(*this), p); }
+    }
+
+    template <typename OTy_, typename... Args_>
+    void construct(OTy_* p, Args_&&... args) {
+        _traits::construct(static_cast<Alloc_&>(*this), p, std::forward<Args_>(args)...);
+    }
+};
+
+} // namespace kangsw::inline containers
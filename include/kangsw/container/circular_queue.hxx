@@ -1,18 +1,53 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
 
 namespace kangsw {
 /**
  * 스레드에 매우 안전하지 않은 클래스입니다.
  * 별도의 스레드와 사용 시 반드시 락 필요
+ *
+ * PowerOfTwo_가 true이면 내부 버퍼 크기를 2의 거듭제곱으로 올림하여, 인덱스 계산의
+ * 나머지 연산을 비트 마스크로 대체합니다. 이 경우 capacity()는 요청한 값보다 클 수 있습니다.
+ *
+ * 기본적으로 가득 찬 큐에 push하면 예외를 던지지만, growth_policy::grow를 켜면
+ * 용량을 두 배로 늘려 deque처럼 사용할 수 있습니다.
  */
-template <typename Ty_>
+template <typename Ty_, bool PowerOfTwo_ = false>
 class circular_queue {
     using chunk_t = std::array<int8_t, sizeof(Ty_)>;
 
+    // Iterators which can be bulk-copied with memcpy, instead of element-wise construction.
+    template <typename It_>
+    static constexpr bool _is_memcpy_compatible
+      = std::is_trivially_copyable_v<Ty_>
+        && std::contiguous_iterator<It_>
+        && std::is_same_v<std::iter_value_t<It_>, Ty_>;
+
 public:
     using value_type = Ty_;
+    using span_type = std::span<Ty_>;
+    using const_span_type = std::span<Ty_ const>;
+
+    struct growth_policy {
+        // Instead of throwing, doubles capacity when full.
+        bool grow = false;
+
+        // Halves capacity when size falls below capacity * shrink_watermark after pop. 0 disables.
+        double shrink_watermark = 0;
+
+        // Automatic shrink never goes below this capacity.
+        size_t min_capacity = 0;
+    };
 
 public:
     template <bool Constant_ = true>
@@ -73,48 +108,59 @@ public:
     };
 
 public:
-    circular_queue(size_t capacity) noexcept :
-        _capacity(capacity + 1), _data(capacity ? std::make_unique<chunk_t[]>(_capacity) : nullptr) {}
-    circular_queue(const circular_queue& op) noexcept { *this = op; }
-    circular_queue(circular_queue&& op) noexcept = default;
+    circular_queue(size_t capacity, growth_policy growth = {}) noexcept :
+        policy(growth), _capacity(_slots(capacity)), _data(capacity ? _alloc(_capacity) : nullptr) {}
+    circular_queue(const circular_queue& op) noexcept :
+        _capacity(_slots(0)) { *this = op; }
+    circular_queue(circular_queue&& op) noexcept :
+        _capacity(_slots(0)) { *this = std::move(op); }
     circular_queue& operator=(circular_queue&& op) noexcept {
         std::swap(_head, op._head);
         std::swap(_tail, op._tail);
         std::swap(_data, op._data);
         std::swap(_capacity, op._capacity);
+        std::swap(policy, op.policy);
         return *this;
     }
 
     circular_queue& operator=(const circular_queue& op) noexcept {
+        if (this == &op) { return *this; }
         clear();
         _head = {};
         _tail = {};
         _capacity = op._capacity;
-        _data = std::make_unique<chunk_t[]>(_capacity);
+        _data = _alloc(_capacity);
+        policy = op.policy;
 
-        std::copy(op.begin(), op.end(), begin());
+        auto [first, second] = op.as_spans();
+        push_n(first.begin(), first.size());
+        push_n(second.begin(), second.size());
         return *this;
     }
 
     void reserve_shrink(size_t new_cap) {
-        if (new_cap == capacity()) { return; }
+        if (_slots(new_cap) == _cap()) { return; }
         if (new_cap == 0) { clear(), _data.reset(), _capacity = 1; }
-        auto n_copy = std::min(size(), new_cap);
 
-        // move available objects
-        circular_queue next{new_cap};
-        std::move(begin(), begin() + n_copy, std::back_inserter(next));
+        // move available objects, segment by segment
+        circular_queue next{new_cap, policy};
+        auto n_move = std::min(size(), next.capacity());
+        auto [first, second] = as_spans();
+        for (auto segment : {first, second}) {
+            auto n = std::min(n_move, segment.size());
+            next.push_n(_move_source(segment.data()), n);
+            n_move -= n;
+        }
 
         // destroies unmoved objects
-        _tail = _jmp(_tail, n_copy);
-        clear(); 
+        clear();
 
         *this = std::move(next);
     }
 
-    void push(Ty_ const& s) { new (_data[_reserve()].data()) Ty_(s); }
-    void push(Ty_&& s) { new (_data[_reserve()].data()) Ty_(std::move(s)); }
-    void pop() { _release(); }
+    void push(Ty_ const& s) { _push(s); }
+    void push(Ty_&& s) { _push(std::move(s)); }
+    void pop() { _release(), _shrink_if_low(); }
     void push_back(Ty_ const& s) { this->push(s); }
     void push_back(Ty_&& s) { this->push(std::move(s)); }
 
@@ -128,7 +174,76 @@ public:
         this->push(std::move(s));
     }
 
+    /**
+     * Pushes n elements starting from first at once.
+     * Trivially copyable elements from contiguous source are copied with at most two memcpy.
+     */
+    template <typename It_>
+    void push_n(It_ first, size_t n) {
+        if (n > capacity() - size()) {
+            if (!policy.grow) { throw std::bad_array_new_length(); }
+
+            // source may refer to elements of this queue, thus secure it before relocation, as _push does.
+            std::vector<Ty_> staged;
+            staged.reserve(n);
+            for (size_t i = 0; i < n; ++i, ++first) { staged.emplace_back(*first); }
+
+            _grow(n);
+            return push_n(_move_source(staged.data()), n);
+        }
+        if (n == 0) { return; }
+
+        if constexpr (_is_memcpy_compatible<It_>) {
+            auto src = std::to_address(first);
+            auto n_first = std::min(n, _cap() - _head);
+            std::memcpy(_ptr(_head), src, n_first * sizeof(Ty_));
+            std::memcpy(_ptr(0), src + n_first, (n - n_first) * sizeof(Ty_));
+            _head = _jmp(_head, n);
+        }
+        else {
+            for (; n; --n, ++first) { push(*first); }
+        }
+    }
+
+    /**
+     * Destroies n elements from the front.
+     */
+    void pop_n(size_t n) { _release_n(n), _shrink_if_low(); }
+
+    /**
+     * Moves n elements from the front into dest, then pops them.
+     */
+    template <typename OutIt_>
+    OutIt_ pop_n(OutIt_ dest, size_t n) {
+        assert(n <= size());
+        if (n == 0) { return dest; }
+
+        auto [first, second] = as_spans();
+        auto n_first = std::min(n, first.size());
+
+        if constexpr (_is_memcpy_compatible<OutIt_>) {
+            std::memcpy(std::to_address(dest), first.data(), n_first * sizeof(Ty_));
+            std::memcpy(std::to_address(dest) + n_first, second.data(), (n - n_first) * sizeof(Ty_));
+            dest += n;
+        }
+        else {
+            dest = std::move(first.begin(), first.begin() + n_first, dest);
+            dest = std::move(second.begin(), second.begin() + (n - n_first), dest);
+        }
+
+        pop_n(n);
+        return dest;
+    }
+
+    /**
+     * Returns up to two contiguous segments which hold every element in order.
+     * Second segment is empty unless the content wraps around the buffer end.
+     */
+    std::pair<span_type, span_type> as_spans() noexcept { return _segments<Ty_>(); }
+    std::pair<const_span_type, const_span_type> as_spans() const noexcept { return _segments<Ty_ const>(); }
+
     size_t size() const {
+        if constexpr (PowerOfTwo_) { return (_head - _tail) & _mask(); }
         return _head >= _tail ? _head - _tail : _head + _cap() - _tail;
     }
 
@@ -151,22 +266,50 @@ public:
 
     template <class Fn_>
     void for_each(Fn_&& fn) {
-        for (size_t it = _tail; it != _head; it = _next(it)) { fn(_at(it)); }
+        auto [first, second] = as_spans();
+        for (auto& e : first) { fn(e); }
+        for (auto& e : second) { fn(e); }
     }
 
     template <class Fn_>
     void for_each(Fn_&& fn) const {
-        for (size_t it = _tail; it != _head; it = _next(it)) { fn(static_cast<const Ty_&>(_at(it))); }
+        auto [first, second] = as_spans();
+        for (auto& e : first) { fn(e); }
+        for (auto& e : second) { fn(e); }
     }
 
-    void clear() {
-        while (!empty()) { pop(); }
-    }
+    void clear() { _release_n(size()); }
 
     ~circular_queue() { clear(); }
 
 private:
     size_t _cap() const noexcept { return _capacity; }
+    size_t _mask() const noexcept { return _capacity - 1; }
+
+    static size_t _slots(size_t capacity) noexcept {
+        if constexpr (PowerOfTwo_) { return std::bit_ceil(capacity + 1); }
+        return capacity + 1;
+    }
+
+    static std::unique_ptr<chunk_t[]> _alloc(size_t slots) {
+        return std::make_unique_for_overwrite<chunk_t[]>(slots);
+    }
+
+    template <typename Ptr_>
+    static auto _move_source(Ptr_ ptr) noexcept {
+        if constexpr (std::is_trivially_copyable_v<Ty_>) { return ptr; }
+        else { return std::make_move_iterator(ptr); }
+    }
+
+    Ty_* _ptr(size_t i) const noexcept {
+        return reinterpret_cast<Ty_*>(const_cast<chunk_t*>(_data.get()) + i);
+    }
+
+    template <typename VTy_>
+    std::pair<std::span<VTy_>, std::span<VTy_>> _segments() const noexcept {
+        if (_head >= _tail) { return {{_ptr(_tail), _head - _tail}, {_ptr(0), 0}}; }
+        return {{_ptr(_tail), _cap() - _tail}, {_ptr(0), _head}};
+    }
 
     size_t _reserve() {
         if (is_full()) throw std::bad_array_new_length();
@@ -176,23 +319,65 @@ private:
     }
 
     size_t _next(size_t current) const noexcept {
+        if constexpr (PowerOfTwo_) { return (current + 1) & _mask(); }
         return ++current == _cap() ? 0 : current;
     }
 
     size_t _prev(size_t current) const noexcept {
+        if constexpr (PowerOfTwo_) { return (current - 1) & _mask(); }
         return --current == ~size_t{} ? _cap() - 1 : current;
     }
 
     size_t _jmp(size_t at, ptrdiff_t jmp) const noexcept {
+        if constexpr (PowerOfTwo_) { return (at + jmp) & _mask(); }
         if (jmp >= 0) { return (at + jmp) % _cap(); }
         return at += jmp, at + _cap() * ((ptrdiff_t)at < 0);
     }
 
     size_t _idx_linear(size_t i) const noexcept {
+        if constexpr (PowerOfTwo_) { return (i - _tail) & _mask(); }
         if (_head >= _tail) { return i; }
         return i - _tail * (i >= _tail) + (_cap() - _tail) * (i < _tail);
     }
 
+    template <typename RTy_>
+    void _push(RTy_&& s) {
+        if (is_full() && policy.grow) {
+            // s may refer to an element of this queue, thus secure it before relocation.
+            Ty_ value(std::forward<RTy_>(s));
+            _grow(1);
+            new (_ptr(_reserve())) Ty_(std::move(value));
+        }
+        else {
+            new (_ptr(_reserve())) Ty_(std::forward<RTy_>(s));
+        }
+    }
+
+    void _grow(size_t n_required) {
+        reserve_shrink(std::max(capacity() * 2, size() + n_required));
+    }
+
+    void _shrink_if_low() {
+        if (policy.shrink_watermark <= 0) { return; }
+
+        auto half = capacity() / 2;
+        if (half >= policy.min_capacity
+            && size() <= half
+            && size() < capacity() * policy.shrink_watermark) {
+            reserve_shrink(half);
+        }
+    }
+
+    void _release_n(size_t n) {
+        assert(n <= size());
+        if constexpr (std::is_trivially_destructible_v<Ty_>) {
+            _tail = _jmp(_tail, n);
+        }
+        else {
+            for (; n; --n) { _release(); }
+        }
+    }
+
     void _release() {
         assert(!empty());
         reinterpret_cast<Ty_&>(_data[_tail]).~Ty_();
@@ -214,6 +399,9 @@ private:
         return _at(_prev(_head));
     }
 
+public:
+    growth_policy policy;
+
 private:
     size_t _capacity;
     std::unique_ptr<chunk_t[]> _data;
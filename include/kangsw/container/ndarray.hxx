@@ -1,61 +1,420 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <filesystem>
+#include <iterator>
 #include <numeric>
+#include <span>
+#include <stdexcept>
 #include <vector>
+#include "kangsw/container/aligned_allocator.hxx"
+#include "kangsw/helpers/counter.hxx"
 #include "kangsw/helpers/zip.hxx"
 
 namespace kangsw::inline containers {
+template <typename Ty_, size_t Dim_, typename Alloc_, typename Layout_>
+class ndarray;
+
+template <typename Ty_, size_t Dim_>
+class mapped_ndarray;
+
 /**
- * N-dimensional array
- * Basically, wrapper of an vector
+ * Layout policies of ndarray, which map index to offset in storage.
+ * Strided layouts can be viewed by ndarray_view.
+ */
+template <bool RowMajor_>
+struct _strided_layout {
+    static constexpr bool is_strided = true;
+
+    template <size_t Dim_>
+    struct mapping {
+        std::array<size_t, Dim_> dims = {};
+        std::array<size_t, Dim_> strides = {};
+
+        void reshape(std::array<size_t, Dim_> const& new_dims) {
+            dims = new_dims;
+            for (size_t n = 0, step = 1; n < Dim_; ++n) {
+                auto i = RowMajor_ ? Dim_ - 1 - n : n;
+                strides[i] = step, step *= dims[i];
+            }
+        }
+
+        size_t operator()(std::array<size_t, Dim_> const& index) const {
+            size_t offset = 0;
+            for (size_t i = 0; i < Dim_; ++i) { offset += index[i] * strides[i]; }
+            return offset;
+        }
+    };
+};
+
+struct layout_row_major : _strided_layout<true> {};
+struct layout_col_major : _strided_layout<false> {};
+
+/**
+ * Stores 2D array as Tile_ x Tile_ blocks, each of which is row-major, thus both of row
+ * and column traversal touch only a few cache lines. Tiles on the right and bottom edges
+ * are shrunk to fit, without any padding.
+ */
+template <size_t Tile_ = 8>
+struct layout_tiled {
+    static_assert(std::has_single_bit(Tile_), "tile size should be power of two");
+    static constexpr bool is_strided = false;
+
+    template <size_t Dim_>
+    struct mapping {
+        static_assert(Dim_ == 2, "tiled layout supports only 2D array");
+        std::array<size_t, 2> dims = {};
+
+        void reshape(std::array<size_t, 2> const& new_dims) { dims = new_dims; }
+
+        size_t operator()(std::array<size_t, 2> const& index) const {
+            auto const tile_row = index[0] / Tile_, tile_col = index[1] / Tile_;
+            auto const height = std::min(Tile_, dims[0] - tile_row * Tile_);
+            auto const width = std::min(Tile_, dims[1] - tile_col * Tile_);
+
+            return tile_row * Tile_ * dims[1] + tile_col * Tile_ * height
+                   + (index[0] % Tile_) * width + index[1] % Tile_;
+        }
+    };
+};
+
+/**
+ * Range of a dimension for ndarray_view::slice, [begin, end) stepping by step.
+ * End is clamped to size of the dimension.
+ */
+struct ndslice {
+    size_t begin = 0;
+    size_t end = ~size_t{};
+    size_t step = 1;
+};
+
+/**
+ * Selects whole dimension in slice
+ */
+constexpr ndslice ndall{};
+
+/**
+ * Non-owning N-dimensional view with per-dimension strides
+ * Can wrap any external memory, e.g. camera buffers or mapped files. Slicing, transposing
+ * and reshaping returns another view over the same memory.
+ *
+ * @code{.cpp}
+    ndarray<int, 3> arr(4, 5, 6);
+    auto col = arr.slice(ndslice{1, 3}, ndall, 2); // 2x5 view
+    auto t = col.transpose();                      // 5x2 view
+ * @endcode
  */
 template <typename Ty_, size_t Dim_ = 1>
-class ndarray {
+class ndarray_view {
+    template <typename, size_t>
+    friend class ndarray_view;
+
 public:
-    using value_type = typename std::vector<Ty_>::value_type;
-    using reference = typename std::vector<Ty_>::reference;
-    using const_reference = typename std::vector<Ty_>::const_reference;
+    using value_type = std::remove_const_t<Ty_>;
+    using element_type = Ty_;
+    using reference = Ty_&;
+    using pointer = Ty_*;
     using size_type = size_t;
     using dimension_type = std::array<size_type, Dim_>;
     enum : size_t { dimension = Dim_ };
 
+    class iterator;
+
 private:
     template <size_type D_, bool Check_ = false, typename T_, typename... Args_>
     size_type _reduce_index(T_ idx, Args_... args) const {
         if constexpr (Check_) {
-            if (idx >= dim_[D_]) {
+            if (size_type(idx) >= dims_[D_]) {
                 throw std::invalid_argument("array index out of range");
             }
         }
 
         if constexpr (sizeof...(Args_)) {
-            return idx * steps_[D_] + _reduce_index<D_ + 1, Check_>(args...);
+            return idx * strides_[D_] + _reduce_index<D_ + 1, Check_>(args...);
         }
         else {
-            return idx;
+            return idx * strides_[D_];
         }
     }
 
     auto _get_index(dimension_type const& r) const {
         size_type index = 0;
-        for (size_type i = 0; i < r.size() - 1; ++i) { index += steps_[i] * r[i]; }
-        // printf("%d %d %d ==> %d\n", r[0], r[1], r[2], index + r.back());
-        return index + r.back();
+        for (size_type i = 0; i < r.size(); ++i) { index += strides_[i] * r[i]; }
+        return index;
     }
 
-    auto _apply_reshape() {
-        data_.resize(std::reduce(dim_.begin(), dim_.end(), size_type(1), std::multiplies<>{}));
+    static dimension_type _packed_strides(dimension_type const& dims) {
+        dimension_type strides;
+        for (size_type i = Dim_, step = 1; i-- > 0;) { strides[i] = step, step *= dims[i]; }
+        return strides;
+    }
+
+public:
+    ndarray_view() noexcept = default;
+    ndarray_view(Ty_* data, dimension_type const& dims) noexcept
+        : ndarray_view(data, dims, _packed_strides(dims)) {}
+    ndarray_view(Ty_* data, dimension_type const& dims, dimension_type const& strides) noexcept
+        : data_(data), dims_(dims), strides_(strides) {}
+
+    ndarray_view(std::span<Ty_> span, dimension_type const& dims)
+        : ndarray_view(span.data(), dims) {
+        if (size() > span.size()) { throw std::invalid_argument("span is smaller than dimensions"); }
+    }
+
+    template <typename OTy_>
+    requires std::is_same_v<Ty_, OTy_ const>
+    ndarray_view(ndarray_view<OTy_, Dim_> const& other) noexcept
+        : data_(other.data_), dims_(other.dims_), strides_(other.strides_) {}
+
+public:
+    template <typename... Idxs_>
+    requires((sizeof...(Idxs_) == dimension) && (std::is_integral_v<Idxs_> && ...))
+      reference
+      operator()(Idxs_... index) const {
+        return data_[_reduce_index<0>(index...)];
+    }
+
+    template <typename... Idxs_>
+    requires((sizeof...(Idxs_) == dimension) && (std::is_integral_v<Idxs_> && ...))
+      reference at(Idxs_... index)
+    const {
+        return data_[_reduce_index<0, true>(index...)];
+    }
+
+    reference operator[](dimension_type const& i) const { return data_[_get_index(i)]; }
+
+    reference at(dimension_type const& i) const {
+        for (size_type d = 0; d < Dim_; ++d) {
+            if (i[d] >= dims_[d]) { throw std::invalid_argument("array index out of range"); }
+        }
+        return (*this)[i];
+    }
+
+    /**
+     * Each argument is either an index, which removes the dimension, or ndslice.
+     */
+    template <typename... Args_>
+    requires((sizeof...(Args_) == dimension) && ((std::is_integral_v<Args_> || std::is_same_v<Args_, ndslice>)&&...))
+    auto slice(Args_... args) const {
+        constexpr size_type out_dim = (size_type(!std::is_integral_v<Args_>) + ... + 0);
+        static_assert(out_dim > 0, "use operator() to access single element");
+
+        ndarray_view<Ty_, out_dim> result;
+        result.data_ = data_;
+        size_type src = 0, dst = 0;
+
+        auto apply = [&](auto arg) {
+            if constexpr (std::is_integral_v<decltype(arg)>) {
+                if (size_type(arg) >= dims_[src]) { throw std::invalid_argument("array index out of range"); }
+                result.data_ += arg * strides_[src];
+            }
+            else {
+                auto end = std::min(arg.end, dims_[src]);
+                if (arg.step == 0) { throw std::invalid_argument("slice step should be positive"); }
+                if (arg.begin > end) { throw std::invalid_argument("slice begin out of range"); }
+
+                result.data_ += arg.begin * strides_[src];
+                result.dims_[dst] = (end - arg.begin + arg.step - 1) / arg.step;
+                result.strides_[dst] = strides_[src] * arg.step;
+                ++dst;
+            }
+            ++src;
+        };
+
+        (apply(args), ...);
+        return result;
+    }
+
+    /**
+     * Reverses order of dimensions
+     */
+    auto transpose() const {
+        ndarray_view result = *this;
+        std::reverse(result.dims_.begin(), result.dims_.end());
+        std::reverse(result.strides_.begin(), result.strides_.end());
+        return result;
+    }
+
+    /**
+     * Permutes dimensions; i'th dimension of result is axes[i]'th dimension of this.
+     */
+    auto transpose(dimension_type const& axes) const {
+        ndarray_view result = *this;
+        for (size_type i = 0; i < Dim_; ++i) {
+            if (axes[i] >= Dim_) { throw std::invalid_argument("invalid axis"); }
+            result.dims_[i] = dims_[axes[i]], result.strides_[i] = strides_[axes[i]];
+        }
+        return result;
+    }
+
+    /**
+     * Reinterprets dimensions over same memory, which requires contiguous view.
+     */
+    template <typename... Values_>
+    requires(sizeof...(Values_) > 0 && (std::is_integral_v<Values_> && ...))
+    auto reshape(Values_... values) const {
+        return reshape(std::array<size_type, sizeof...(Values_)>{size_type(values)...});
+    }
+
+    template <size_type NewDim_>
+    auto reshape(std::array<size_type, NewDim_> const& new_dims) const {
+        if (!is_contiguous()) { throw std::logic_error{"cannot reshape non-contiguous view"}; }
+        if (std::reduce(new_dims.begin(), new_dims.end(), size_type(1), std::multiplies<>{}) != size()) {
+            throw std::logic_error{"reshape size mismatch"};
+        }
+
+        return ndarray_view<Ty_, NewDim_>{data_, new_dims};
+    }
+
+    /**
+     * Copies elements into new owning array
+     */
+    auto copy() const {
+        ndarray<value_type, Dim_, std::allocator<value_type>, layout_row_major> result;
+        result.reshape(dims_);
+        std::copy(begin(), end(), result.begin());
+        return result;
+    }
+
+    /**
+     * Evaluates an ndarray expression of same dimensions into this view; see ndarray_expr.hxx
+     */
+    template <typename Expr_>
+    requires requires { typename Expr_::_ndexpr_tag; }
+    void assign(Expr_ const& expr) const { evaluate(*this, expr); }
+
+    /**
+     * Maps an ndarray file written by save() or ndarray_writer without copying; see ndarray_file.hxx
+     * View of const element maps the file read-only.
+     */
+    static mapped_ndarray<Ty_, Dim_> map(std::filesystem::path const& path);
+
+    bool is_contiguous() const { return strides_ == _packed_strides(dims_); }
+    size_type size() const { return std::reduce(dims_.begin(), dims_.end(), size_type(1), std::multiplies<>{}); }
+    bool empty() const { return size() == 0; }
+    auto dims() const { return dims_; }
+    auto strides() const { return strides_; }
+    pointer data() const { return data_; }
 
-        auto it_dim = dim_.end() - 1;
-        auto it_dim_end = dim_.begin();
-        auto it_step = steps_.end() - 1;
+    iterator begin() const { return empty() ? end() : iterator{this, {}}; }
+    iterator end() const {
+        dimension_type index = {};
+        index[0] = dims_[0];
+        return iterator{this, index};
+    }
+
+private:
+    pointer data_ = nullptr;
+    dimension_type dims_ = {};
+    dimension_type strides_ = {};
+};
 
-        for (size_t step = 1;; --it_step) {
-            step *= *it_dim;
-            *it_step = step;
+/**
+ * Visits elements in row-major order
+ */
+template <typename Ty_, size_t Dim_>
+class ndarray_view<Ty_, Dim_>::iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::remove_const_t<Ty_>;
+    using difference_type = ptrdiff_t;
+    using pointer = Ty_*;
+    using reference = Ty_&;
 
-            if (--it_dim == it_dim_end) { break; }
+    iterator() noexcept = default;
+    iterator(ndarray_view const* owner, dimension_type const& index) noexcept
+        : owner_(owner), index_(index), offset_(owner->_get_index(index)) {}
+
+    reference operator*() const { return owner_->data_[offset_]; }
+    pointer operator->() const { return owner_->data_ + offset_; }
+
+    iterator& operator++() {
+        for (size_type d = Dim_ - 1;; --d) {
+            offset_ += owner_->strides_[d];
+            if (++index_[d] < owner_->dims_[d] || d == 0) { break; }
+
+            offset_ -= owner_->strides_[d] * owner_->dims_[d];
+            index_[d] = 0;
         }
+        return *this;
+    }
+
+    iterator operator++(int) {
+        auto copy = *this;
+        return ++*this, copy;
+    }
+
+    bool operator==(iterator const& o) const { return index_ == o.index_; }
+    bool operator!=(iterator const& o) const { return !(*this == o); }
+
+    dimension_type const& index() const { return index_; }
+
+private:
+    ndarray_view const* owner_ = nullptr;
+    dimension_type index_ = {};
+    size_type offset_ = 0;
+};
+
+template <typename Ty_, size_t Dim_>
+ndarray_view(std::span<Ty_>, std::array<size_t, Dim_> const&) -> ndarray_view<Ty_, Dim_>;
+
+template <typename Ty_, size_t Dim_>
+ndarray_view(Ty_*, std::array<size_t, Dim_> const&) -> ndarray_view<Ty_, Dim_>;
+
+/**
+ * N-dimensional array
+ * Basically, wrapper of an vector
+ *
+ * Storage is allocated by Alloc_, e.g. aligned_allocator for SIMD access, or any arena or
+ * huge page backed allocator.
+ *
+ * Elements are placed by Layout_; iterators visit elements in storage order, while indexing
+ * and assign() always use logical row-major order.
+ */
+template <typename Ty_, size_t Dim_ = 1, typename Alloc_ = std::allocator<Ty_>, typename Layout_ = layout_row_major>
+class ndarray {
+public:
+    using allocator_type = Alloc_;
+    using layout_type = Layout_;
+    using mapping_type = typename Layout_::template mapping<Dim_>;
+    // default allocator keeps plain std::vector storage, so vector() binds to std::vector<Ty_>&
+    using vector_type = std::conditional_t<std::is_same_v<Alloc_, std::allocator<Ty_>>,
+                                           std::vector<Ty_>,
+                                           std::vector<Ty_, default_init_allocator<Alloc_>>>;
+    using value_type = typename vector_type::value_type;
+    using reference = typename vector_type::reference;
+    using const_reference = typename vector_type::const_reference;
+    using size_type = size_t;
+    using dimension_type = std::array<size_type, Dim_>;
+    enum : size_t { dimension = Dim_ };
+
+private:
+    template <bool Check_ = false, typename... Args_>
+    size_type _reduce_index(Args_... args) const {
+        dimension_type index = {size_type(args)...};
+        if constexpr (Check_) { _check_index(index); }
+        return map_(index);
+    }
+
+    void _check_index(dimension_type const& index) const {
+        for (size_type i = 0; i < Dim_; ++i) {
+            if (index[i] >= dim_[i]) { throw std::invalid_argument("array index out of range"); }
+        }
+    }
+
+    auto _get_index(dimension_type const& r) const { return map_(r); }
+
+    auto _apply_reshape(bool initialize = true) {
+        auto const prev_size = data_.size();
+        data_.resize(std::reduce(dim_.begin(), dim_.end(), size_type(1), std::multiplies<>{}));
+
+        // default_init_allocator leaves trivial elements uninitialized
+        if constexpr (!std::is_same_v<Alloc_, std::allocator<Ty_>> && std::is_trivially_default_constructible_v<Ty_>) {
+            if (initialize && data_.size() > prev_size) { std::fill(data_.begin() + prev_size, data_.end(), Ty_{}); }
+        }
+
+        map_.reshape(dim_);
     }
 
 public:
@@ -66,6 +425,19 @@ public:
     }
 
     ndarray() noexcept = default;
+    explicit ndarray(Alloc_ const& alloc) noexcept : data_(alloc) {}
+
+    /**
+     * Evaluates an ndarray expression; see ndarray_expr.hxx
+     */
+    template <typename Expr_>
+    requires requires { typename Expr_::_ndexpr_tag; }
+    ndarray(Expr_ const& expr) { evaluate(*this, expr); }
+
+    template <typename Expr_>
+    requires requires { typename Expr_::_ndexpr_tag; }
+    ndarray& operator=(Expr_ const& expr) { return evaluate(*this, expr), *this; }
+
     ndarray(ndarray const&) noexcept = default;
     ndarray(ndarray&&) noexcept = default;
     ndarray& operator=(ndarray&&) noexcept = default;
@@ -87,35 +459,46 @@ public:
         _apply_reshape();
     }
 
+    /**
+     * Newly added trivial elements are left uninitialized; existing ones are preserved.
+     * Unavailable with std::allocator, of which storage is a plain std::vector that always
+     * value-initializes; use a custom allocator, e.g. aligned_ndarray.
+     */
+    void reshape(dimension_type const& new_dims, uninitialized_t)
+      requires(!std::is_same_v<Alloc_, std::allocator<Ty_>>) {
+        dim_ = new_dims;
+        _apply_reshape(false);
+    }
+
     template <typename... Idxs_> //
     requires((sizeof...(Idxs_) == dimension) && (std::is_integral_v<Idxs_> && ...))
       reference
       operator()(Idxs_... index) {
-        return data_[_reduce_index<0>(index...)];
+        return data_[_reduce_index(index...)];
     }
 
     template <typename... Idxs_>
     requires((sizeof...(Idxs_) == dimension) && (std::is_integral_v<Idxs_> && ...))
       const_reference
       operator()(Idxs_... index) const {
-        return data_[_reduce_index<0>(index...)];
+        return data_[_reduce_index(index...)];
     }
 
     template <typename... Idxs_>
     requires((sizeof...(Idxs_) == dimension) && (std::is_integral_v<Idxs_> && ...))
       reference at(Idxs_... index) {
-        return data_[_reduce_index<0, true>(index...)];
+        return data_[_reduce_index<true>(index...)];
     }
 
     template <typename... Idxs_>
     requires((sizeof...(Idxs_) == dimension) && (std::is_integral_v<Idxs_> && ...))
       const_reference at(Idxs_... index)
     const {
-        return data_[_reduce_index<0, true>(index...)];
+        return data_[_reduce_index<true>(index...)];
     }
 
-    const_reference at(dimension_type const& i) const { return data_.at(_get_index(i)); }
-    reference at(dimension_type const& i) { return data_.at(_get_index(i)); }
+    const_reference at(dimension_type const& i) const { return _check_index(i), data_[_get_index(i)]; }
+    reference at(dimension_type const& i) { return _check_index(i), data_[_get_index(i)]; }
     const_reference operator[](dimension_type const& i) const { return data_[_get_index(i)]; }
     reference operator[](dimension_type const& i) { return data_[_get_index(i)]; }
 
@@ -127,6 +510,8 @@ public:
     auto size() const { return data_.size(); }
     auto dims() const { return dim_; }
     auto shrink_to_fit() { data_.shrink_to_fit(); }
+    auto reserve(size_type capacity) { data_.reserve(capacity); }
+    Alloc_ get_allocator() const { return data_.get_allocator(); }
 
     auto data() const { return data_.data(); }
     auto data() { return data_.data(); }
@@ -134,10 +519,30 @@ public:
     auto& vector() { return data_; }
     auto& vector() const { return data_; }
 
+    auto& mapping() const { return map_; }
+
+    auto view() requires Layout_::is_strided { return ndarray_view<Ty_, Dim_>{data_.data(), dim_, map_.strides}; }
+    auto view() const requires Layout_::is_strided { return ndarray_view<Ty_ const, Dim_>{data_.data(), dim_, map_.strides}; }
+    operator ndarray_view<Ty_, Dim_>() requires Layout_::is_strided { return view(); }
+    operator ndarray_view<Ty_ const, Dim_>() const requires Layout_::is_strided { return view(); }
+
+    template <typename... Args_>
+    auto slice(Args_... args) { return view().slice(args...); }
+    template <typename... Args_>
+    auto slice(Args_... args) const { return view().slice(args...); }
+    auto transpose() { return view().transpose(); }
+    auto transpose() const { return view().transpose(); }
+
     template <typename It_>
     void assign(It_ first, It_ last) {
         if (std::distance(first, last) != size()) { throw std::logic_error{"Assignment size mismatch"}; }
-        data_.assign(first, last);
+
+        if constexpr (std::is_same_v<Layout_, layout_row_major>) {
+            data_.assign(first, last);
+        }
+        else {
+            for (auto const& idx : counter(dim_)) { (*this)[idx] = *first++; }
+        }
     }
 
     void assign(std::initializer_list<value_type> values) { assign(values.begin(), values.end()); }
@@ -147,8 +552,77 @@ public:
 
 private:
     dimension_type dim_;
-    std::array<size_type, dimension - 1> steps_;
-    std::vector<Ty_> data_;
+    mapping_type map_;
+    vector_type data_;
 }; // namespace kangsw::inline containers
 
+/**
+ * ndarray of which storage is aligned by Align_ bytes
+ */
+template <typename Ty_, size_t Dim_ = 1, size_t Align_ = 64>
+using aligned_ndarray = ndarray<Ty_, Dim_, aligned_allocator<Ty_, Align_>>;
+
+/**
+ * Reshapes an array of which every element is overwritten next, skipping initialization
+ * if its storage allows.
+ */
+template <typename Ty_, size_t Dim_, typename Alloc_, typename Layout_>
+void _reshape_for_overwrite(ndarray<Ty_, Dim_, Alloc_, Layout_>& arr, std::array<size_t, Dim_> const& dims) {
+    if constexpr (requires { arr.reshape(dims, uninitialized); }) { arr.reshape(dims, uninitialized); }
+    else { arr.reshape(dims); }
+}
+
+/**
+ * Visits every (row, col) in [r0, r1) x [c0, c1) in cache-oblivious order, by splitting
+ * longer side in half recursively until the region fits in a small block.
+ */
+template <typename Fn_>
+void _cache_oblivious_for_each(size_t r0, size_t r1, size_t c0, size_t c1, Fn_&& fn) {
+    constexpr size_t block = 16;
+
+    while (r1 - r0 > block || c1 - c0 > block) {
+        if (r1 - r0 >= c1 - c0) {
+            auto mid = (r0 + r1) / 2;
+            _cache_oblivious_for_each(r0, mid, c0, c1, fn);
+            r0 = mid;
+        }
+        else {
+            auto mid = (c0 + c1) / 2;
+            _cache_oblivious_for_each(r0, r1, c0, mid, fn);
+            c0 = mid;
+        }
+    }
+
+    for (auto r = r0; r < r1; ++r) {
+        for (auto c = c0; c < c1; ++c) { fn(r, c); }
+    }
+}
+
+/**
+ * Copies 2D array into another layout, e.g. row-major into column-major, which is
+ * transpose of storage.
+ */
+template <typename NewLayout_, typename Ty_, typename Alloc_, typename Layout_>
+auto copy_layout(ndarray<Ty_, 2, Alloc_, Layout_> const& src) {
+    ndarray<Ty_, 2, Alloc_, NewLayout_> dst{src.get_allocator()};
+    _reshape_for_overwrite(dst, src.dims());
+
+    auto const [rows, cols] = src.dims();
+    _cache_oblivious_for_each(0, rows, 0, cols, [&](size_t r, size_t c) { dst(r, c) = src(r, c); });
+    return dst;
+}
+
+/**
+ * Transposed copy of 2D array, in same layout
+ */
+template <typename Ty_, typename Alloc_, typename Layout_>
+auto transpose_copy(ndarray<Ty_, 2, Alloc_, Layout_> const& src) {
+    ndarray<Ty_, 2, Alloc_, Layout_> dst{src.get_allocator()};
+    auto const [rows, cols] = src.dims();
+    _reshape_for_overwrite(dst, {cols, rows});
+
+    _cache_oblivious_for_each(0, rows, 0, cols, [&](size_t r, size_t c) { dst(c, r) = src(r, c); });
+    return dst;
+}
+
 } // namespace kangsw::inline containers
@@ -0,0 +1,530 @@
+#pragma once
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include "kangsw/container/ndarray.hxx"
+#include "kangsw/helpers/for_each.hxx"
+
+namespace kangsw::inline containers {
+/**
+ * Base of lazily evaluated elementwise ndarray expressions
+ * Expressions only refer to their operand arrays, thus operands should outlive them.
+ *
+ * Operands are broadcasted like numpy; dimensions are aligned from the last one, and
+ * dimension of size 1 or missing dimension is repeated.
+ *
+ * @code{.cpp}
+    ndarray<float, 2> a(480, 640), b(480, 640), c;
+    ndarray<float, 1> bias(640);
+    c = a * b + bias;  // single pass, without any temporary array
+    auto rows = sum(c, 1);
+ * @endcode
+ */
+template <typename Derived_>
+struct ndexpr {
+    using _ndexpr_tag = void;
+
+    Derived_ const& _self() const { return static_cast<Derived_ const&>(*this); }
+
+    /**
+     * Evaluates into new array
+     */
+    auto eval() const {
+        ndarray<typename Derived_::value_type, Derived_::rank> result;
+        evaluate(result, _self());
+        return result;
+    }
+};
+
+template <typename Ty_>
+struct _is_ndarray_like : std::false_type {};
+template <typename Ty_, size_t Dim_, typename Alloc_, typename Layout_>
+struct _is_ndarray_like<ndarray<Ty_, Dim_, Alloc_, Layout_>> : std::bool_constant<Layout_::is_strided> {};
+template <typename Ty_, size_t Dim_>
+struct _is_ndarray_like<ndarray_view<Ty_, Dim_>> : std::true_type {};
+
+template <typename Ty_>
+concept _ndexpr_type = requires { typename std::remove_cvref_t<Ty_>::_ndexpr_tag; };
+
+template <typename Ty_>
+concept _nd_nonscalar = _ndexpr_type<Ty_> || _is_ndarray_like<std::remove_cvref_t<Ty_>>::value;
+
+template <typename Ty_>
+concept _nd_operand = _nd_nonscalar<Ty_> || std::is_arithmetic_v<std::remove_cvref_t<Ty_>>;
+
+/**
+ * Leaf of expression, which refers to an array
+ */
+template <typename Ty_, size_t Dim_>
+struct _nd_terminal : ndexpr<_nd_terminal<Ty_, Dim_>> {
+    using value_type = std::remove_const_t<Ty_>;
+    enum : size_t { rank = Dim_ };
+
+    template <size_t D_>
+    struct evaluator {
+        Ty_ const* data;
+        Ty_ const* base;
+        std::array<size_t, D_> strides;
+        bool flat;
+
+        void seek(std::array<size_t, D_> const& index) {
+            base = data;
+            for (size_t d = 0; d + 1 < D_; ++d) { base += index[d] * strides[d]; }
+        }
+
+        value_type inner(size_t i) const { return base[i * strides[D_ - 1]]; }
+        value_type flat_at(size_t i) const { return data[i]; }
+    };
+
+    auto dims() const { return view.dims(); }
+
+    template <size_t D_>
+    auto evaluator_for(std::array<size_t, D_> const& target) const {
+        evaluator<D_> ev{view.data(), view.data(), {}, D_ == Dim_};
+        for (size_t d = D_ - Dim_, k = 0; d < D_; ++d, ++k) {
+            auto broadcast = view.dims()[k] != target[d];
+            ev.strides[d] = broadcast ? 0 : view.strides()[k];
+            ev.flat = ev.flat && !broadcast;
+        }
+        ev.flat = ev.flat && view.is_contiguous();
+        return ev;
+    }
+
+    ndarray_view<Ty_ const, Dim_> view;
+};
+
+template <typename Ty_>
+struct _nd_scalar : ndexpr<_nd_scalar<Ty_>> {
+    using value_type = Ty_;
+    enum : size_t { rank = 0 };
+
+    template <size_t D_>
+    struct evaluator {
+        Ty_ value;
+        bool flat = true;
+
+        void seek(std::array<size_t, D_> const&) {}
+        Ty_ inner(size_t) const { return value; }
+        Ty_ flat_at(size_t) const { return value; }
+    };
+
+    auto dims() const { return std::array<size_t, 0>{}; }
+
+    template <size_t D_>
+    auto evaluator_for(std::array<size_t, D_> const&) const { return evaluator<D_>{value}; }
+
+    Ty_ value;
+};
+
+template <typename Ty_>
+auto _nd_wrap(Ty_ const& operand) {
+    if constexpr (_ndexpr_type<Ty_>) {
+        return operand;
+    }
+    else if constexpr (_is_ndarray_like<Ty_>::value) {
+        using view_type = decltype(std::as_const(operand).view());
+        return _nd_terminal<typename view_type::value_type, view_type::dimension>{{}, operand};
+    }
+    else {
+        return _nd_scalar<Ty_>{{}, operand};
+    }
+}
+
+template <typename Ty_, size_t Dim_>
+auto _nd_wrap(ndarray_view<Ty_, Dim_> const& operand) {
+    return _nd_terminal<std::remove_const_t<Ty_>, Dim_>{{}, operand};
+}
+
+/**
+ * Applies Fn_ on each broadcasted elements of operands
+ */
+template <typename Fn_, typename... Args_>
+struct _nd_map : ndexpr<_nd_map<Fn_, Args_...>> {
+    using value_type = std::invoke_result_t<Fn_ const&, typename Args_::value_type...>;
+    enum : size_t { rank = std::max({size_t(Args_::rank)...}) };
+
+    template <size_t D_>
+    struct evaluator {
+        Fn_ fn;
+        std::tuple<typename Args_::template evaluator<D_>...> args;
+        bool flat;
+
+        void seek(std::array<size_t, D_> const& index) {
+            std::apply([&](auto&... arg) { (arg.seek(index), ...); }, args);
+        }
+
+        value_type inner(size_t i) const {
+            return std::apply([&](auto const&... arg) { return fn(arg.inner(i)...); }, args);
+        }
+
+        value_type flat_at(size_t i) const {
+            return std::apply([&](auto const&... arg) { return fn(arg.flat_at(i)...); }, args);
+        }
+    };
+
+    std::array<size_t, rank> dims() const {
+        std::array<size_t, rank> result;
+        result.fill(1);
+
+        std::apply(
+          [&](auto const&... arg) {
+              auto merge = [&](auto const& arg_dims) {
+                  for (size_t d = rank - arg_dims.size(), k = 0; d < rank; ++d, ++k) {
+                      if (arg_dims[k] == 1 || arg_dims[k] == result[d]) { continue; }
+                      if (result[d] != 1) { throw std::invalid_argument("operand dimensions cannot be broadcasted"); }
+                      result[d] = arg_dims[k];
+                  }
+              };
+              (merge(arg.dims()), ...);
+          },
+          args);
+
+        return result;
+    }
+
+    template <size_t D_>
+    auto evaluator_for(std::array<size_t, D_> const& target) const {
+        return std::apply(
+          [&](auto const&... arg) {
+              auto ev = evaluator<D_>{fn, {arg.evaluator_for(target)...}, true};
+              ev.flat = std::apply([](auto const&... e) { return (e.flat && ...); }, ev.args);
+              return ev;
+          },
+          args);
+    }
+
+    Fn_ fn;
+    std::tuple<Args_...> args;
+};
+
+/**
+ * Lazily applies fn on each broadcasted elements of given arrays, views, expressions or scalars.
+ */
+template <typename Fn_, typename... Args_>
+requires(_nd_operand<Args_>&&...) && (_nd_nonscalar<Args_> || ...)
+auto ndmap(Fn_&& fn, Args_ const&... args) {
+    return _nd_map<std::decay_t<Fn_>, decltype(_nd_wrap(args))...>{{}, std::forward<Fn_>(fn), {_nd_wrap(args)...}};
+}
+
+#define KANGSW_NDEXPR_BINARY_OPERATOR(OP, FN)                     \
+    template <_nd_operand L_, _nd_operand R_>                     \
+    requires(_nd_nonscalar<L_> || _nd_nonscalar<R_>)              \
+    auto operator OP(L_ const& l, R_ const& r) {                  \
+        return ndmap(FN{}, l, r);                                 \
+    }
+
+KANGSW_NDEXPR_BINARY_OPERATOR(+, std::plus<>)
+KANGSW_NDEXPR_BINARY_OPERATOR(-, std::minus<>)
+KANGSW_NDEXPR_BINARY_OPERATOR(*, std::multiplies<>)
+KANGSW_NDEXPR_BINARY_OPERATOR(/, std::divides<>)
+#undef KANGSW_NDEXPR_BINARY_OPERATOR
+
+template <_nd_nonscalar Ty_>
+auto operator-(Ty_ const& operand) { return ndmap(std::negate<>{}, operand); }
+
+template <typename Ty_, size_t Dim_, typename Expr_>
+void _nd_evaluate_range(ndarray_view<Ty_, Dim_> const& dst, Expr_ const& expr, size_t first, size_t last) {
+    auto ev = _nd_wrap(expr).evaluator_for(dst.dims());
+
+    if (ev.flat && dst.is_contiguous()) {
+        // every operand shares the layout; single loop which compiler vectorizes.
+        auto* out = dst.data();
+        for (size_t i = first; i < last; ++i) { out[i] = ev.flat_at(i); }
+        return;
+    }
+
+    // [first, last) are indexes of rows, which are all dimensions except the last one.
+    auto const dims = dst.dims();
+    auto const strides = dst.strides();
+    std::array<size_t, Dim_> index = {};
+    for (size_t d = Dim_ - 1, row = first; d-- > 0;) { index[d] = row % dims[d], row /= dims[d]; }
+
+    for (size_t row = first; row < last; ++row) {
+        ev.seek(index);
+        auto* out = &dst[index];
+        for (size_t i = 0; i < dims[Dim_ - 1]; ++i) { out[i * strides[Dim_ - 1]] = ev.inner(i); }
+
+        for (size_t d = Dim_ - 1; d-- > 0;) {
+            if (++index[d] < dims[d]) { break; }
+            index[d] = 0;
+        }
+    }
+}
+
+template <typename Ty_, size_t Dim_, typename Expr_>
+auto _nd_evaluate_units(ndarray_view<Ty_, Dim_> const& dst, Expr_ const& expr) {
+    auto flat = _nd_wrap(expr).evaluator_for(dst.dims()).flat && dst.is_contiguous();
+    return flat ? dst.size() : dst.size() / std::max<size_t>(1, dst.dims()[Dim_ - 1]);
+}
+
+template <typename Ty_, size_t Dim_, typename Expr_>
+auto _nd_evaluation_target(ndarray_view<Ty_, Dim_> const& dst, Expr_ const& expr) {
+    if (dst.dims() != _nd_wrap(expr).dims()) { throw std::invalid_argument("dimension mismatch"); }
+    return dst;
+}
+
+template <typename Ty_, size_t Dim_, typename Alloc_, typename Layout_, typename Expr_>
+auto _nd_broadcast_dims(ndarray<Ty_, Dim_, Alloc_, Layout_> const&, Expr_ const& expr) {
+    static_assert(decltype(_nd_wrap(expr))::rank <= Dim_, "expression has higher rank than destination");
+
+    // expression of lower rank is broadcasted to leading dimensions of 1
+    auto dims = _nd_wrap(expr).dims();
+    typename ndarray<Ty_, Dim_, Alloc_, Layout_>::dimension_type new_dims;
+    new_dims.fill(1);
+    std::copy(dims.begin(), dims.end(), new_dims.end() - dims.size());
+    return new_dims;
+}
+
+template <typename Ty_, size_t Dim_, typename Alloc_, typename Layout_, typename Expr_>
+requires Layout_::is_strided
+auto _nd_evaluation_target(ndarray<Ty_, Dim_, Alloc_, Layout_>& dst, Expr_ const& expr) {
+    auto new_dims = _nd_broadcast_dims(dst, expr);
+    if (dst.dims() != new_dims) { _reshape_for_overwrite(dst, new_dims); }
+    return dst.view();
+}
+
+template <typename Ty_, size_t Dim_, typename Fn_>
+void _nd_for_each_terminal(_nd_terminal<Ty_, Dim_> const& node, Fn_&& fn) { fn(node.view); }
+
+template <typename Ty_, typename Fn_>
+void _nd_for_each_terminal(_nd_scalar<Ty_> const&, Fn_&&) {}
+
+template <typename MapFn_, typename... Args_, typename Fn_>
+void _nd_for_each_terminal(_nd_map<MapFn_, Args_...> const& node, Fn_&& fn) {
+    std::apply([&](auto const&... arg) { (_nd_for_each_terminal(arg, fn), ...); }, node.args);
+}
+
+/**
+ * [first, last) addresses of elements of a view
+ */
+template <typename Ty_, size_t Dim_>
+std::pair<void const*, void const*> _nd_extent(ndarray_view<Ty_, Dim_> const& view) {
+    if (view.empty()) { return {nullptr, nullptr}; }
+
+    size_t last = 0;
+    for (size_t d = 0; d < Dim_; ++d) { last += (view.dims()[d] - 1) * view.strides()[d]; }
+    return {view.data(), view.data() + last + 1};
+}
+
+/**
+ * Checks if any operand refers to storage of dst other than through the very same elements,
+ * or dst is about to be resized; either way evaluating in place reads overwritten or freed elements.
+ */
+template <typename Ty_, size_t Dim_, typename Expr_>
+bool _nd_aliases(ndarray_view<Ty_, Dim_> const& dst, Expr_ const& expr, bool resizing) {
+    auto const [first, last] = _nd_extent(dst);
+    bool aliased = false;
+
+    _nd_for_each_terminal(_nd_wrap(expr), [&]<typename OTy_, size_t ODim_>(ndarray_view<OTy_, ODim_> const& view) {
+        auto const [op_first, op_last] = _nd_extent(view);
+        if (!std::less<>{}(op_first, last) || !std::less<>{}(first, op_last)) { return; }
+
+        bool same_elements = false;
+        if constexpr (ODim_ == Dim_) {
+            same_elements = !resizing && op_first == first && view.dims() == dst.dims() && view.strides() == dst.strides();
+        }
+        aliased = aliased || !same_elements;
+    });
+
+    return aliased;
+}
+
+template <typename Ty_, size_t Dim_, typename Expr_>
+bool _nd_needs_staging(ndarray_view<Ty_, Dim_> const& dst, Expr_ const& expr) {
+    // mismatching dimension is reported by _nd_evaluation_target
+    return dst.dims() == _nd_wrap(expr).dims() && _nd_aliases(dst, expr, false);
+}
+
+template <typename Ty_, size_t Dim_, typename Alloc_, typename Layout_, typename Expr_>
+bool _nd_needs_staging(ndarray<Ty_, Dim_, Alloc_, Layout_>& dst, Expr_ const& expr) {
+    return _nd_aliases(dst.view(), expr, dst.dims() != _nd_broadcast_dims(dst, expr));
+}
+
+/**
+ * Evaluates into a fresh array by evaluate_fn, then moves it into the destination array, or
+ * copies it into the destination view.
+ */
+template <typename Ty_, size_t Dim_, typename Fn_>
+void _nd_stage(ndarray_view<Ty_, Dim_> const& dst, Fn_&& evaluate_fn) {
+    ndarray<std::remove_const_t<Ty_>, Dim_> staged;
+    evaluate_fn(staged);
+    evaluate(dst, staged);
+}
+
+template <typename Ty_, size_t Dim_, typename Alloc_, typename Layout_, typename Fn_>
+void _nd_stage(ndarray<Ty_, Dim_, Alloc_, Layout_>& dst, Fn_&& evaluate_fn) {
+    ndarray<Ty_, Dim_, Alloc_, Layout_> staged{dst.get_allocator()};
+    evaluate_fn(staged);
+    dst = std::move(staged);
+}
+
+/**
+ * Evaluates expression into an array, which is resized to fit, or a view of same dimensions.
+ * If an operand overlaps destination, other than being the very same elements of it, or refers
+ * to the array being resized, the result is evaluated into a temporary first.
+ */
+template <typename Dst_, _nd_operand Expr_>
+void evaluate(Dst_&& dst, Expr_ const& expr) {
+    if (_nd_needs_staging(dst, expr)) { return _nd_stage(dst, [&](auto& staged) { evaluate(staged, expr); }); }
+
+    auto target = _nd_evaluation_target(dst, expr);
+    _nd_evaluate_range(target, expr, 0, _nd_evaluate_units(target, expr));
+}
+
+/**
+ * Evaluates expression in parallel, by splitting rows (or elements if every operand is
+ * contiguous) into num_partitions.
+ */
+template <typename ExPo_, typename Dst_, _nd_operand Expr_>
+requires std::is_execution_policy_v<std::remove_cvref_t<ExPo_>>
+void evaluate(ExPo_&& policy, Dst_&& dst, Expr_ const& expr, size_t num_partitions = std::thread::hardware_concurrency()) {
+    if (_nd_needs_staging(dst, expr)) {
+        return _nd_stage(dst, [&](auto& staged) { evaluate(std::forward<ExPo_>(policy), staged, expr, num_partitions); });
+    }
+
+    auto target = _nd_evaluation_target(dst, expr);
+    auto const num_units = _nd_evaluate_units(target, expr);
+    if (num_units == 0) { return; }
+
+    num_partitions = std::clamp<size_t>(num_partitions, 1, num_units);
+    iota<size_t> partitions(num_partitions);
+    for_each_partition(
+      std::forward<ExPo_>(policy), partitions.begin(), partitions.end(),
+      [&](size_t partition) {
+          _nd_evaluate_range(
+            target, expr,
+            num_units * partition / num_partitions,
+            num_units * (partition + 1) / num_partitions);
+      },
+      num_partitions);
+}
+
+/**
+ * Visits every element of expression with fn(index, value), in row-major order.
+ */
+template <_nd_nonscalar Expr_, typename Fn_>
+void _nd_visit(Expr_ const& expr, Fn_&& fn) {
+    auto const node = _nd_wrap(expr);
+    auto const dims = node.dims();
+    constexpr size_t dim = dims.size();
+    if (std::ranges::find(dims, 0) != dims.end()) { return; }
+
+    auto ev = node.evaluator_for(dims);
+    std::array<size_t, dim> index = {};
+    for (;;) {
+        ev.seek(index);
+        for (index[dim - 1] = 0; index[dim - 1] < dims[dim - 1]; ++index[dim - 1]) { fn(index, ev.inner(index[dim - 1])); }
+
+        size_t d = dim - 1;
+        for (; d-- > 0;) {
+            if (++index[d] < dims[d]) { break; }
+            index[d] = 0;
+        }
+        if (d == size_t(-1)) { break; }
+    }
+}
+
+/**
+ * Reduces along axis; result has one less dimension.
+ * init(value, index) initializes an output element, and acc(output, value, index) accumulates.
+ */
+template <typename OutTy_, _nd_nonscalar Expr_, typename Init_, typename Acc_>
+auto _nd_reduce_axis(Expr_ const& expr, size_t axis, Init_&& init, Acc_&& acc) {
+    constexpr size_t dim = decltype(_nd_wrap(expr))::rank;
+    static_assert(dim > 1, "use reduction without axis for one-dimensional expression");
+    if (axis >= dim) { throw std::invalid_argument("invalid axis"); }
+
+    auto const dims = _nd_wrap(expr).dims();
+    std::array<size_t, dim - 1> out_dims;
+    for (size_t d = 0, k = 0; d < dim; ++d) {
+        if (d != axis) { out_dims[k++] = dims[d]; }
+    }
+
+    ndarray<OutTy_, dim - 1> result;
+    _reshape_for_overwrite(result, out_dims);
+
+    _nd_visit(expr, [&](std::array<size_t, dim> const& index, auto value) {
+        std::array<size_t, dim - 1> out_index;
+        for (size_t d = 0, k = 0; d < dim; ++d) {
+            if (d != axis) { out_index[k++] = index[d]; }
+        }
+
+        if (index[axis] == 0) { init(result[out_index], value, index[axis]); }
+        else { acc(result[out_index], value, index[axis]); }
+    });
+
+    return result;
+}
+
+template <_nd_nonscalar Expr_>
+auto sum(Expr_ const& expr) {
+    typename decltype(_nd_wrap(expr))::value_type result = {};
+    _nd_visit(expr, [&](auto const&, auto value) { result += value; });
+    return result;
+}
+
+template <_nd_nonscalar Expr_>
+auto sum(Expr_ const& expr, size_t axis) {
+    using value_type = typename decltype(_nd_wrap(expr))::value_type;
+    return _nd_reduce_axis<value_type>(
+      expr, axis,
+      [](auto& out, auto value, size_t) { out = value; },
+      [](auto& out, auto value, size_t) { out += value; });
+}
+
+template <_nd_nonscalar Expr_>
+auto min(Expr_ const& expr) {
+    auto result = std::numeric_limits<typename decltype(_nd_wrap(expr))::value_type>::max();
+    _nd_visit(expr, [&](auto const&, auto value) { result = std::min(result, value); });
+    return result;
+}
+
+template <_nd_nonscalar Expr_>
+auto min(Expr_ const& expr, size_t axis) {
+    using value_type = typename decltype(_nd_wrap(expr))::value_type;
+    return _nd_reduce_axis<value_type>(
+      expr, axis,
+      [](auto& out, auto value, size_t) { out = value; },
+      [](auto& out, auto value, size_t) { out = std::min(out, value); });
+}
+
+/**
+ * Index of first smallest element
+ */
+template <_nd_nonscalar Expr_>
+auto argmin(Expr_ const& expr) {
+    using value_type = typename decltype(_nd_wrap(expr))::value_type;
+    std::array<size_t, decltype(_nd_wrap(expr))::rank> result = {};
+    auto best = std::numeric_limits<value_type>::max();
+    bool found = false;
+    _nd_visit(expr, [&](auto const& index, value_type value) {
+        if (!found || value < best) { best = value, result = index, found = true; }
+    });
+    return result;
+}
+
+/**
+ * Indexes of first smallest elements along axis
+ */
+template <_nd_nonscalar Expr_>
+auto argmin(Expr_ const& expr, size_t axis) {
+    using value_type = typename decltype(_nd_wrap(expr))::value_type;
+    auto pairs = _nd_reduce_axis<std::pair<value_type, size_t>>(
+      expr, axis,
+      [](auto& out, value_type value, size_t i) { out = {value, i}; },
+      [](auto& out, value_type value, size_t i) {
+          if (value < out.first) { out = {value, i}; }
+      });
+
+    ndarray<size_t, decltype(pairs)::dimension> result;
+    _reshape_for_overwrite(result, pairs.dims());
+    std::transform(pairs.begin(), pairs.end(), result.begin(), [](auto& p) { return p.second; });
+    return result;
+}
+
+} // namespace kangsw::inline containers
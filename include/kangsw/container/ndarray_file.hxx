@@ -0,0 +1,350 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include "kangsw/container/ndarray.hxx"
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define KANGSW_DEFINED_NOMINMAX
+#define NOMINMAX
+#endif
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define KANGSW_DEFINED_WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#if defined(KANGSW_DEFINED_NOMINMAX)
+#undef NOMINMAX
+#undef KANGSW_DEFINED_NOMINMAX
+#endif
+#if defined(KANGSW_DEFINED_WIN32_LEAN_AND_MEAN)
+#undef WIN32_LEAN_AND_MEAN
+#undef KANGSW_DEFINED_WIN32_LEAN_AND_MEAN
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kangsw::inline containers {
+/**
+ * Header of ndarray binary file
+ * Payload starts at payload_offset, which is aligned by page size so that the mapped
+ * payload is aligned enough for any SIMD access. Strides are in elements.
+ */
+struct ndarray_file_header {
+    enum : size_t { max_dimension = 8, payload_alignment = 4096 };
+    enum : uint8_t { little_endian = 1, big_endian = 2 };
+    enum : uint8_t { kind_signed = 'i', kind_unsigned = 'u', kind_float = 'f', kind_bytes = 'b' };
+
+    std::array<char, 8> magic = {'K', 'N', 'D', 'A', 'R', 'R', 'A', 'Y'};
+    uint32_t version = 1;
+    uint8_t endian = std::endian::native == std::endian::little ? little_endian : big_endian;
+    uint8_t element_kind = kind_bytes;
+    uint16_t element_size = 0;
+    uint32_t dimension = 0;
+    uint32_t _reserved = 0;
+    uint64_t payload_offset = payload_alignment;
+    uint64_t payload_size = 0;
+    std::array<uint64_t, max_dimension> dims = {};
+    std::array<uint64_t, max_dimension> strides = {};
+
+    template <typename Ty_>
+    static constexpr uint8_t kind_of() {
+        if constexpr (std::is_floating_point_v<Ty_>) { return kind_float; }
+        else if constexpr (std::is_integral_v<Ty_> && std::is_signed_v<Ty_>) { return kind_signed; }
+        else if constexpr (std::is_integral_v<Ty_>) { return kind_unsigned; }
+        else { return kind_bytes; }
+    }
+
+    bool is_valid() const { return magic == ndarray_file_header{}.magic && version == 1; }
+};
+
+static_assert(std::is_trivially_copyable_v<ndarray_file_header>);
+static_assert(sizeof(ndarray_file_header) <= ndarray_file_header::payload_alignment);
+
+/**
+ * Maps whole file into memory, read-only or shared writable.
+ */
+class file_mapping {
+public:
+    file_mapping() noexcept = default;
+    file_mapping(std::filesystem::path const& path, bool writable) {
+#if defined(_WIN32)
+        file_ = ::CreateFileW(
+          path.c_str(), GENERIC_READ | (writable ? GENERIC_WRITE : 0), FILE_SHARE_READ,
+          nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) { _throw_last_error("CreateFile"); }
+
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(file_, &size)) { _throw_last_error("GetFileSizeEx"); }
+        size_ = size_t(size.QuadPart);
+
+        mapping_ = ::CreateFileMappingW(file_, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr) { _throw_last_error("CreateFileMapping"); }
+
+        ptr_ = ::MapViewOfFile(mapping_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+        if (ptr_ == nullptr) { _throw_last_error("MapViewOfFile"); }
+#else
+        fd_ = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd_ < 0) { _throw_last_error("open"); }
+
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) { _throw_last_error("fstat"); }
+        size_ = size_t(st.st_size);
+
+        ptr_ = ::mmap(nullptr, size_, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd_, 0);
+        if (ptr_ == MAP_FAILED) {
+            ptr_ = nullptr;
+            _throw_last_error("mmap");
+        }
+#endif
+    }
+
+    file_mapping(file_mapping&& other) noexcept { swap(other); }
+    file_mapping& operator=(file_mapping&& other) noexcept {
+        file_mapping{std::move(other)}.swap(*this);
+        return *this;
+    }
+
+    file_mapping(file_mapping const&) = delete;
+    file_mapping& operator=(file_mapping const&) = delete;
+    ~file_mapping() { _release(); }
+
+public:
+    std::byte* data() const { return static_cast<std::byte*>(ptr_); }
+    size_t size() const { return size_; }
+
+    void swap(file_mapping& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        std::swap(size_, other.size_);
+#if defined(_WIN32)
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+#else
+        std::swap(fd_, other.fd_);
+#endif
+    }
+
+private:
+    [[noreturn]] void _throw_last_error(char const* what) {
+#if defined(_WIN32)
+        std::error_code ec{int(::GetLastError()), std::system_category()};
+#else
+        std::error_code ec{errno, std::generic_category()};
+#endif
+        _release();
+        throw std::system_error(ec, what);
+    }
+
+    void _release() noexcept {
+#if defined(_WIN32)
+        if (ptr_) { ::UnmapViewOfFile(ptr_); }
+        if (mapping_) { ::CloseHandle(mapping_); }
+        if (file_ != INVALID_HANDLE_VALUE) { ::CloseHandle(file_); }
+        file_ = INVALID_HANDLE_VALUE, mapping_ = nullptr;
+#else
+        if (ptr_) { ::munmap(ptr_, size_); }
+        if (fd_ >= 0) { ::close(fd_); }
+        fd_ = -1;
+#endif
+        ptr_ = nullptr, size_ = 0;
+    }
+
+private:
+    void* ptr_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+/**
+ * ndarray_view over a mapped ndarray file, which keeps the mapping alive.
+ * Mapping of const element is read-only; otherwise writes go directly to the file.
+ */
+template <typename Ty_, size_t Dim_>
+class mapped_ndarray : public ndarray_view<Ty_, Dim_> {
+public:
+    using view_type = ndarray_view<Ty_, Dim_>;
+    using value_type = typename view_type::value_type;
+    static_assert(std::is_trivially_copyable_v<value_type>, "only trivially copyable elements can be mapped");
+    static_assert(Dim_ <= ndarray_file_header::max_dimension);
+
+    mapped_ndarray() noexcept = default;
+    explicit mapped_ndarray(std::filesystem::path const& path)
+        : file_(path, !std::is_const_v<Ty_>) {
+        ndarray_file_header header;
+        if (file_.size() < sizeof header) { throw std::runtime_error("not an ndarray file"); }
+        std::memcpy(&header, file_.data(), sizeof header);
+
+        if (!header.is_valid()) { throw std::runtime_error("not an ndarray file"); }
+        if (header.endian != ndarray_file_header{}.endian) { throw std::runtime_error("endianness mismatch"); }
+        if (header.dimension != Dim_) { throw std::runtime_error("dimension mismatch"); }
+        if (header.element_size != sizeof(value_type)
+            || header.element_kind != ndarray_file_header::kind_of<value_type>()) {
+            throw std::runtime_error("element type mismatch");
+        }
+        if (header.payload_offset + header.payload_size > file_.size()
+            || header.payload_offset % alignof(value_type) != 0) {
+            throw std::runtime_error("truncated ndarray file");
+        }
+
+        typename view_type::dimension_type dims, strides;
+        size_t extent = 1;
+        for (size_t i = 0; i < Dim_; ++i) {
+            dims[i] = size_t(header.dims[i]), strides[i] = size_t(header.strides[i]);
+            extent += dims[i] ? (dims[i] - 1) * strides[i] : 0;
+        }
+        if (std::ranges::find(dims, 0) != dims.end()) { extent = 0; }
+        if (extent * sizeof(value_type) > header.payload_size) {
+            throw std::runtime_error("incomplete ndarray file");
+        }
+
+        auto* data = reinterpret_cast<Ty_*>(file_.data() + header.payload_offset);
+        static_cast<view_type&>(*this) = view_type{data, dims, strides};
+    }
+
+    view_type const& view() const { return *this; }
+
+private:
+    file_mapping file_;
+};
+
+template <typename Ty_, size_t Dim_>
+mapped_ndarray<Ty_, Dim_> ndarray_view<Ty_, Dim_>::map(std::filesystem::path const& path) {
+    return mapped_ndarray<Ty_, Dim_>{path};
+}
+
+/**
+ * Writes ndarray file sequentially in row-major order, without holding whole array in memory.
+ * close() should be called after exactly size() elements are written; otherwise the file is
+ * left incomplete, which map() refuses to open.
+ * Destructor also finalizes a complete file, but swallows any error; call close() to see them.
+ */
+template <typename Ty_, size_t Dim_>
+class ndarray_writer {
+public:
+    static_assert(std::is_trivially_copyable_v<Ty_>, "only trivially copyable elements can be written");
+    static_assert(Dim_ <= ndarray_file_header::max_dimension);
+    using dimension_type = std::array<size_t, Dim_>;
+
+    ndarray_writer(std::filesystem::path const& path, dimension_type const& dims)
+        : file_(path, std::ios::binary | std::ios::trunc) {
+        if (!file_) { throw std::system_error(errno, std::generic_category(), "cannot open ndarray file"); }
+
+        header_.element_kind = ndarray_file_header::kind_of<Ty_>();
+        header_.element_size = sizeof(Ty_);
+        header_.dimension = Dim_;
+
+        size_ = 1;
+        for (size_t i = Dim_; i-- > 0;) {
+            header_.dims[i] = dims[i], header_.strides[i] = size_;
+            size_ *= dims[i];
+        }
+
+        // payload size is recorded on close, thus unfinished file has none.
+        _write_header();
+        file_.seekp(std::streamoff(header_.payload_offset));
+    }
+
+    ~ndarray_writer() {
+        if (file_.is_open() && written_ == size_) { _finalize(); }
+    }
+
+    ndarray_writer(ndarray_writer const&) = delete;
+    ndarray_writer& operator=(ndarray_writer const&) = delete;
+
+public:
+    void write(std::span<Ty_ const> elems) {
+        if (written_ + elems.size() > size_) { throw std::length_error("too many elements"); }
+        file_.write(reinterpret_cast<char const*>(elems.data()), std::streamsize(elems.size_bytes()));
+        if (!file_) { throw std::system_error(errno, std::generic_category(), "ndarray file write failed"); }
+        written_ += elems.size();
+    }
+
+    void write(Ty_ const& elem) { write(std::span{&elem, 1}); }
+
+    void close() {
+        if (written_ != size_) { throw std::logic_error("ndarray file is incomplete"); }
+        if (!_finalize()) { throw std::system_error(errno, std::generic_category(), "ndarray file close failed"); }
+    }
+
+    size_t size() const { return size_; }
+    size_t num_written() const { return written_; }
+
+private:
+    bool _finalize() noexcept {
+        // stream is not configured to throw, thus failure is only reported by its state.
+        header_.payload_size = size_ * sizeof(Ty_);
+        _write_header();
+        file_.close();
+        return bool(file_);
+    }
+
+    void _write_header() {
+        // pad whole header area, so that a writer never extends it by seeking
+        std::array<char, ndarray_file_header::payload_alignment> block = {};
+        std::memcpy(block.data(), &header_, sizeof header_);
+
+        auto pos = file_.tellp();
+        file_.seekp(0);
+        file_.write(block.data(), block.size());
+        if (pos > std::streamoff(block.size())) { file_.seekp(pos); }
+    }
+
+private:
+    std::ofstream file_;
+    ndarray_file_header header_;
+    size_t size_ = 0;
+    size_t written_ = 0;
+};
+
+/**
+ * Saves an array or view into ndarray file
+ */
+template <typename Ty_, size_t Dim_>
+void save(std::filesystem::path const& path, ndarray_view<Ty_, Dim_> const& view) {
+    using value_type = std::remove_const_t<Ty_>;
+    ndarray_writer<value_type, Dim_> writer{path, view.dims()};
+
+    if (view.is_contiguous()) {
+        writer.write(std::span<value_type const>{view.data(), view.size()});
+    }
+    else {
+        std::vector<value_type> buffer;
+        buffer.reserve(4096);
+        for (auto& elem : view) {
+            buffer.push_back(elem);
+            if (buffer.size() == buffer.capacity()) { writer.write(buffer), buffer.clear(); }
+        }
+        writer.write(buffer);
+    }
+
+    writer.close();
+}
+
+template <typename Ty_, size_t Dim_, typename Alloc_, typename Layout_>
+requires Layout_::is_strided
+void save(std::filesystem::path const& path, ndarray<Ty_, Dim_, Alloc_, Layout_> const& arr) {
+    save(path, arr.view());
+}
+
+} // namespace kangsw::inline containers
@@ -0,0 +1,167 @@
+#pragma once
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "kangsw/container/aligned_allocator.hxx"
+#include "kangsw/helpers/zip.hxx"
+
+namespace kangsw::inline containers {
+/**
+ * Structure of arrays. Each field lives in its own aligned contiguous array, thus loops over
+ * some of fields stream only the memory they need.
+ *
+ * @code
+ * soa_vector<float, float, int> particles;
+ * particles.push_back(0.f, 1.f, 42);
+ * for (auto [pos, vel] : particles.fields<0, 1>()) { pos += vel * dt; } // vectorizable
+ * @endcode
+ */
+template <typename... Ts_>
+class soa_vector {
+public:
+    static_assert(sizeof...(Ts_) > 0);
+
+    template <typename Ty_>
+    using array_type = std::vector<Ty_, default_init_allocator<aligned_allocator<Ty_>>>;
+
+    using size_type = size_t;
+    using value_type = std::tuple<Ts_...>;
+    using reference = std::tuple<Ts_&...>;
+    using const_reference = std::tuple<Ts_ const&...>;
+    using iterator = _zip_impl::_zip_iterator<false, Ts_*...>;
+    using const_iterator = _zip_impl::_zip_iterator<false, Ts_ const*...>;
+
+    template <size_t I_>
+    using field_type = std::tuple_element_t<I_, value_type>;
+
+    enum : size_t { num_fields = sizeof...(Ts_) };
+
+public:
+    soa_vector() noexcept = default;
+    explicit soa_vector(size_type size) { resize(size); }
+    soa_vector(size_type size, uninitialized_t) { resize(size, uninitialized); }
+
+public:
+    size_type size() const { return std::get<0>(arrays_).size(); }
+    bool empty() const { return size() == 0; }
+    size_type capacity() const { return std::get<0>(arrays_).capacity(); }
+
+    void reserve(size_type n) {
+        std::apply([n](auto&... arrays) { (arrays.reserve(n), ...); }, arrays_);
+    }
+
+    void resize(size_type n) {
+        _all_or_nothing([&] { std::apply([n](auto&... arrays) { (arrays.resize(n, Ts_{}), ...); }, arrays_); });
+    }
+
+    /**
+     * Newly added trivial elements are left uninitialized
+     */
+    void resize(size_type n, uninitialized_t) {
+        _all_or_nothing([&] { std::apply([n](auto&... arrays) { (arrays.resize(n), ...); }, arrays_); });
+    }
+
+    void clear() noexcept {
+        std::apply([](auto&... arrays) { (arrays.clear(), ...); }, arrays_);
+    }
+
+    void push_back(Ts_... values) {
+        _all_or_nothing([&] {
+            _for_each_field([&]<size_t I_>(std::integral_constant<size_t, I_>) {
+                std::get<I_>(arrays_).push_back(std::move(std::get<I_>(std::forward_as_tuple(values...))));
+            });
+        });
+    }
+
+    void pop_back() {
+        std::apply([](auto&... arrays) { (arrays.pop_back(), ...); }, arrays_);
+    }
+
+    reference operator[](size_type i) { return _at(i, std::index_sequence_for<Ts_...>{}); }
+    const_reference operator[](size_type i) const { return _at(i, std::index_sequence_for<Ts_...>{}); }
+
+    reference at(size_type i) { return _check(i), (*this)[i]; }
+    const_reference at(size_type i) const { return _check(i), (*this)[i]; }
+
+    reference back() { return (*this)[size() - 1]; }
+    const_reference back() const { return (*this)[size() - 1]; }
+
+    /**
+     * Contiguous array of I_-th field
+     */
+    template <size_t I_>
+    std::span<field_type<I_>> field() { return std::get<I_>(arrays_); }
+
+    template <size_t I_>
+    std::span<field_type<I_> const> field() const { return std::get<I_>(arrays_); }
+
+    /**
+     * Zips subset of fields; the others are never touched while iterating.
+     */
+    template <size_t... I_>
+    auto fields() { return _zip_fields<field_type<I_>*...>(std::get<I_>(arrays_).data()...); }
+
+    template <size_t... I_>
+    auto fields() const { return _zip_fields<field_type<I_> const*...>(std::get<I_>(arrays_).data()...); }
+
+    iterator begin() { return {_data(std::index_sequence_for<Ts_...>{})}; }
+    iterator end() { return begin() + size(); }
+    const_iterator begin() const { return {_data(std::index_sequence_for<Ts_...>{})}; }
+    const_iterator end() const { return begin() + size(); }
+
+private:
+    /**
+     * Each array grows with strong guarantee by itself; if one of them throws, the others
+     * already grown are truncated back, thus fields never go out of sync.
+     */
+    template <typename Fn_>
+    void _all_or_nothing(Fn_&& fn) {
+        auto const prev_size = size();
+        try {
+            fn();
+        } catch (...) {
+            std::apply([prev_size](auto&... arrays) {
+                ((void)[&] { while (arrays.size() > prev_size) { arrays.pop_back(); } }(), ...);
+            }, arrays_);
+            throw;
+        }
+    }
+
+    template <typename Fn_>
+    void _for_each_field(Fn_&& fn) {
+        [&]<size_t... I_>(std::index_sequence<I_...>) {
+            (fn(std::integral_constant<size_t, I_>{}), ...);
+        }(std::index_sequence_for<Ts_...>{});
+    }
+
+    template <size_t... I_>
+    reference _at(size_type i, std::index_sequence<I_...>) { return {std::get<I_>(arrays_)[i]...}; }
+
+    template <size_t... I_>
+    const_reference _at(size_type i, std::index_sequence<I_...>) const { return {std::get<I_>(arrays_)[i]...}; }
+
+    template <size_t... I_>
+    auto _data(std::index_sequence<I_...>) { return std::make_tuple(std::get<I_>(arrays_).data()...); }
+
+    template <size_t... I_>
+    auto _data(std::index_sequence<I_...>) const { return std::make_tuple(std::get<I_>(arrays_).data()...); }
+
+    template <typename... Ptrs_>
+    auto _zip_fields(Ptrs_... data) const {
+        _zip_impl::_zip_range<false, Ptrs_...> zips;
+        zips.begin_ = std::make_tuple(data...);
+        zips.end_ = std::make_tuple(data + size()...);
+        return zips;
+    }
+
+    void _check(size_type i) const {
+        if (i >= size()) { throw std::out_of_range("soa_vector index out of range"); }
+    }
+
+private:
+    std::tuple<array_type<Ts_>...> arrays_;
+};
+
+} // namespace kangsw::inline containers
@@ -1,7 +1,13 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <functional>
 #include <iterator>
 #include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <utility>
 #include "tuple_for_each.hxx"
 
 namespace kangsw::inline counters {
@@ -174,37 +180,53 @@ private:
 
 class _counter_end_marker_t {};
 
+/**
+ * N-dimensional counter iterator, which visits every index of given extents in row-major order.
+ * Keeps linear offset along with the index, thus can be advanced or measured in constant time.
+ * Subscript returns the index n steps ahead, as other random access iterators do.
+ * Dereference yields the index by value, as subscript does, thus bind it by value or const&.
+ */
 template <typename Ty_, size_t Dim_>
 class _counter {
 public:
     enum { num_dimension = Dim_ };
 
-    using iterator_category = std::forward_iterator_tag;
+    using dimension = std::array<Ty_, num_dimension>;
+
+    using iterator_category = std::random_access_iterator_tag;
     using difference_type = ptrdiff_t;
-    using value_type = Ty_;
-    using reference = value_type&;
-    using pointer = value_type*;
+    using value_type = dimension;
+    using reference = dimension;
+    using pointer = dimension const*;
 
-    using dimension = std::array<Ty_, num_dimension>;
+public:
+    constexpr _counter() noexcept = default;
+    constexpr _counter(dimension const& extents, size_t offset = 0) noexcept
+        : max(extents) {
+        for (size_t i = Dim_, step = 1; i-- > 0;) { strides_[i] = step, step *= std::max<size_t>(1, max[i]); }
+        _seek(offset);
+    }
 
 public:
     template <typename... Ints_>
     constexpr _counter& fetch_from(Ints_&&... ints) { return *this; }
 
-    constexpr auto& operator[](size_t dim) const { return current[dim]; }
-    constexpr auto& operator[](size_t dim) { return current[dim]; }
-
-    template <size_t N_ = Dim_ - 1>
     constexpr void incr() {
-        if constexpr (N_ == size_t(-1)) {
-            current = max;
+        ++offset_;
+        for (size_t i = Dim_ - 1; i > 0; --i) {
+            if (++current[i] != max[i]) { return; }
+            current[i] = Ty_{};
         }
-        else {
-            if (++current[N_] == max[N_]) {
-                current[N_] = value_type{};
-                incr<N_ - 1>();
-            }
+        ++current[0];
+    }
+
+    constexpr void decr() {
+        --offset_;
+        for (size_t i = Dim_ - 1; i > 0; --i) {
+            if (current[i]-- != Ty_{}) { return; }
+            current[i] = max[i] - 1;
         }
+        --current[0];
     }
 
     constexpr _counter& operator++() { return incr(), *this; }
@@ -214,29 +236,432 @@ public:
         return cpy;
     }
 
-    constexpr bool operator==(_counter const& o) const { return current == o.current; }
-    constexpr bool operator!=(_counter const& o) const { return !(*this == o); }
+    constexpr _counter& operator--() { return decr(), *this; }
+    constexpr _counter operator--(int) {
+        auto cpy = *this;
+        decr();
+        return cpy;
+    }
+
+    constexpr _counter& operator+=(difference_type n) { return _seek(offset_ + n), *this; }
+    constexpr _counter& operator-=(difference_type n) { return _seek(offset_ - n), *this; }
+    constexpr friend _counter operator+(_counter c, difference_type n) { return c += n; }
+    constexpr friend _counter operator+(difference_type n, _counter c) { return c += n; }
+    constexpr friend _counter operator-(_counter c, difference_type n) { return c -= n; }
+    constexpr difference_type operator-(_counter const& o) const { return difference_type(offset_ - o.offset_); }
+
+    constexpr dimension operator[](difference_type n) const { return *(*this + n); }
 
-    // constexpr bool operator==(_counter_end_marker_t) const { return current[0] == max[0]; }
-    // constexpr bool operator!=(_counter_end_marker_t) const { return current[0] != max[0]; }
+    constexpr bool operator==(_counter const& o) const { return offset_ == o.offset_; }
+    constexpr bool operator!=(_counter const& o) const { return offset_ != o.offset_; }
+    constexpr auto operator<=>(_counter const& o) const { return offset_ <=> o.offset_; }
 
-    constexpr auto& operator*() const { return current; }
+    constexpr dimension operator*() const { return current; }
     constexpr auto operator->() const { return &current; }
-    constexpr auto& operator*() { return current; }
-    constexpr auto operator->() { return &current; }
+
+    /** linear offset of current index */
+    constexpr size_t offset() const { return offset_; }
+
+private:
+    constexpr void _seek(size_t offset) {
+        offset_ = offset;
+        for (size_t i = 0; i < Dim_; ++i) {
+            current[i] = Ty_(offset / strides_[i]);
+            offset %= strides_[i];
+        }
+    }
 
 public:
-    dimension max;
-    dimension current;
+    dimension max = {};
+    dimension current = {};
+
+private:
+    std::array<size_t, Dim_> strides_ = {};
+    size_t offset_ = 0;
+};
+
+/**
+ * Traversal policies of multi dimensional counter; see _count_index::traverse()
+ */
+namespace traversal {
+/** Visits tiles in row-major order, and elements of each tile in row-major order */
+template <size_t Dim_>
+struct tiled {
+    std::array<size_t, Dim_> tile;
+};
+
+template <typename... Ints_>
+tiled(Ints_...) -> tiled<sizeof...(Ints_)>;
+
+/** Visits elements in Z-order, interleaving bits of each dimension */
+struct morton_t {};
+constexpr morton_t morton;
+
+/** Visits 2D elements along hilbert curve, which suits square-like extents */
+struct hilbert_t {};
+constexpr hilbert_t hilbert;
+
+/** Visits rows of innermost dimension as contiguous runs, in random access manner */
+struct inner_run_t {};
+constexpr inner_run_t inner_run;
+} // namespace traversal
+
+/**
+ * Common interface of counter ranges which can be split for parallel iteration
+ */
+template <typename Derived_>
+struct _count_chunkable {
+    /**
+     * Returns i-th of n balanced chunks, which differ in length at most by one.
+     */
+    constexpr auto chunk(size_t i, size_t n) const {
+        auto& self = static_cast<Derived_ const&>(*this);
+        auto first = self.begin();
+        auto size = self.size();
+        return std::ranges::subrange{first + size * i / n, first + size * (i + 1) / n};
+    }
+
+    /**
+     * Splits whole range into n balanced chunks, e.g. to distribute over threads.
+     * @code
+     * std::ranges::for_each(counter(h, w).chunks(n), [](auto chunk) { for (auto [i, j] : chunk) { ... } });
+     * @endcode
+     */
+    constexpr auto chunks(size_t n) const {
+        return std::views::iota(size_t{}, n)
+               | std::views::transform([self = static_cast<Derived_ const&>(*this), n](size_t i) {
+                     return self.chunk(i, n);
+                 });
+    }
+};
+
+/**
+ * Range of counter iterators which can only be visited sequentially
+ */
+template <typename It_>
+struct _count_sequence {
+    constexpr It_ begin() const { return first; }
+    constexpr It_ end() const { return last; }
+
+    It_ first;
+    It_ last;
+};
+
+/**
+ * Counter which visits tiles in row-major order. Tiles on the boundary are clipped.
+ */
+template <typename Ty_, size_t Dim_>
+class _tiled_counter {
+public:
+    using dimension = std::array<Ty_, Dim_>;
+
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = ptrdiff_t;
+    using value_type = dimension;
+    using reference = dimension const&;
+    using pointer = dimension const*;
+
+public:
+    constexpr _tiled_counter() noexcept = default;
+    constexpr _tiled_counter(dimension const& extents, std::array<size_t, Dim_> const& tile, bool at_end)
+        : max_(extents), tile_(tile) {
+        for (auto& t : tile_) { t = std::max<size_t>(t, 1); }
+        at_end = at_end || std::ranges::find(max_, Ty_{}) != max_.end();
+        if (at_end) { current_ = origin_ = max_; }
+        else { _enter_tile(); }
+    }
+
+    constexpr _tiled_counter& operator++() {
+        for (size_t i = Dim_; i-- > 0;) {
+            if (++current_[i] != tile_end_[i]) { return *this; }
+            current_[i] = origin_[i];
+        }
+
+        for (size_t i = Dim_; i-- > 0;) {
+            if ((origin_[i] += Ty_(tile_[i])) < max_[i]) { return _enter_tile(), *this; }
+            origin_[i] = Ty_{};
+        }
+
+        current_ = origin_ = max_;
+        return *this;
+    }
+
+    constexpr _tiled_counter operator++(int) {
+        auto cpy = *this;
+        ++*this;
+        return cpy;
+    }
+
+    constexpr bool operator==(_tiled_counter const& o) const { return current_ == o.current_; }
+    constexpr auto& operator*() const { return current_; }
+    constexpr auto operator->() const { return &current_; }
+
+private:
+    constexpr void _enter_tile() {
+        current_ = origin_;
+        for (size_t i = 0; i < Dim_; ++i) { tile_end_[i] = std::min<Ty_>(max_[i], origin_[i] + Ty_(tile_[i])); }
+    }
+
+private:
+    dimension max_ = {};
+    dimension current_ = {};
+    dimension origin_ = {};
+    dimension tile_end_ = {};
+    std::array<size_t, Dim_> tile_ = {};
+};
+
+/**
+ * Counter which visits elements in Z-order. Each dimension owns as many bits as it needs, and
+ * bits are interleaved while available, thus the code space is less than 2^Dim_ times of
+ * actual size. Codes out of extents are skipped.
+ */
+template <typename Ty_, size_t Dim_>
+class _morton_counter {
+public:
+    using dimension = std::array<Ty_, Dim_>;
+
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = ptrdiff_t;
+    using value_type = dimension;
+    using reference = dimension const&;
+    using pointer = dimension const*;
+
+public:
+    constexpr _morton_counter() noexcept = default;
+    constexpr _morton_counter(dimension const& extents, bool at_end)
+        : max_(extents) {
+        std::array<int, Dim_> bits;
+        int total_bits = 0;
+        for (size_t i = 0; i < Dim_; ++i) {
+            bits[i] = max_[i] > 1 ? std::bit_width(uint64_t(max_[i] - 1)) : 0;
+            total_bits += bits[i];
+        }
+        if (total_bits >= 64) { throw std::invalid_argument("extents are too large for morton order"); }
+
+        // interleave from lowest bit, giving innermost dimension the lowest one
+        std::array<uint8_t, Dim_> num_lower = {};
+        for (int level = 0, bit = 0; bit < total_bits; ++level) {
+            for (size_t i = Dim_; i-- > 0;) {
+                if (level < bits[i]) {
+                    owner_[bit] = uint8_t(i), lower_[bit++] = num_lower;
+                    ++num_lower[i];
+                }
+            }
+        }
+
+        end_code_ = uint64_t(1) << total_bits;
+        at_end = at_end || std::ranges::find(max_, Ty_{}) != max_.end();
+        if (at_end) { code_ = end_code_, current_ = max_; }
+    }
+
+    constexpr _morton_counter& operator++() {
+        do {
+            // increment clears trailing ones, and sets the lowest zero bit
+            auto pos = std::countr_one(code_);
+            auto& lower = lower_[pos];
+            for (size_t i = 0; i < Dim_; ++i) { current_[i] &= ~Ty_((uint64_t(1) << lower[i]) - 1); }
+            current_[owner_[pos]] |= Ty_(uint64_t(1) << lower[owner_[pos]]);
+        } while (++code_ < end_code_ && !_in_range());
+
+        if (code_ == end_code_) { current_ = max_; }
+        return *this;
+    }
+
+    constexpr _morton_counter operator++(int) {
+        auto cpy = *this;
+        ++*this;
+        return cpy;
+    }
+
+    constexpr bool operator==(_morton_counter const& o) const { return code_ == o.code_; }
+    constexpr auto& operator*() const { return current_; }
+    constexpr auto operator->() const { return &current_; }
+
+private:
+    constexpr bool _in_range() const {
+        bool in_range = true;
+        for (size_t i = 0; i < Dim_; ++i) { in_range = in_range && current_[i] < max_[i]; }
+        return in_range;
+    }
+
+private:
+    dimension max_ = {};
+    dimension current_ = {};
+    std::array<uint8_t, 64> owner_ = {};                 // dimension which owns each code bit
+    std::array<std::array<uint8_t, Dim_>, 64> lower_ = {}; // number of bits of each dimension below
+    uint64_t code_ = 0;
+    uint64_t end_code_ = 0;
+};
+
+/**
+ * Counter which visits 2D elements along hilbert curve over bounding square of power of two.
+ * Each step decodes curve distance in O(log n); points out of extents are skipped.
+ */
+template <typename Ty_>
+class _hilbert_counter {
+public:
+    using dimension = std::array<Ty_, 2>;
+
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = ptrdiff_t;
+    using value_type = dimension;
+    using reference = dimension const&;
+    using pointer = dimension const*;
+
+public:
+    constexpr _hilbert_counter() noexcept = default;
+    constexpr _hilbert_counter(dimension const& extents, bool at_end)
+        : max_(extents) {
+        side_ = std::bit_ceil(uint64_t(std::max(max_[0], max_[1])));
+        end_distance_ = side_ * side_;
+        at_end = at_end || max_[0] == Ty_{} || max_[1] == Ty_{};
+        if (at_end) { distance_ = end_distance_, current_ = max_; }
+    }
+
+    constexpr _hilbert_counter& operator++() {
+        while (++distance_ < end_distance_) {
+            _decode();
+            if (current_[0] < max_[0] && current_[1] < max_[1]) { return *this; }
+        }
+
+        current_ = max_;
+        return *this;
+    }
+
+    constexpr _hilbert_counter operator++(int) {
+        auto cpy = *this;
+        ++*this;
+        return cpy;
+    }
+
+    constexpr bool operator==(_hilbert_counter const& o) const { return distance_ == o.distance_; }
+    constexpr auto& operator*() const { return current_; }
+    constexpr auto operator->() const { return &current_; }
+
+private:
+    constexpr void _decode() {
+        uint64_t x = 0, y = 0;
+        for (uint64_t s = 1, t = distance_; s < side_; s *= 2, t /= 4) {
+            uint64_t rx = 1 & (t / 2), ry = 1 & (t ^ rx);
+            if (ry == 0) {
+                if (rx == 1) { x = s - 1 - x, y = s - 1 - y; }
+                std::swap(x, y);
+            }
+            x += s * rx, y += s * ry;
+        }
+        current_ = {Ty_(y), Ty_(x)};
+    }
+
+private:
+    dimension max_ = {};
+    dimension current_ = {};
+    uint64_t side_ = 0;
+    uint64_t distance_ = 0;
+    uint64_t end_distance_ = 0;
+};
+
+/**
+ * Contiguous run of innermost dimension, which starts from index first.
+ * Iterating a run yields innermost coordinate, thus inner loop has no carry.
+ */
+template <typename Ty_, size_t Dim_>
+struct count_run {
+    constexpr auto begin() const { return _counter<Ty_, 1>{first.back()}; }
+    constexpr auto end() const { return _counter<Ty_, 1>{Ty_(first.back() + length)}; }
+    constexpr size_t size() const { return size_t(length); }
+
+    std::array<Ty_, Dim_> first;
+    Ty_ length;
+};
+
+/**
+ * Random access iterator over rows of innermost dimension
+ */
+template <typename Ty_, size_t Dim_>
+class _run_counter {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type = ptrdiff_t;
+    using value_type = count_run<Ty_, Dim_>;
+    using reference = value_type;
+    using pointer = void;
+
+public:
+    constexpr _run_counter() noexcept = default;
+    constexpr _run_counter(_counter<Ty_, Dim_> base) noexcept : base_(base) {}
+
+    constexpr _run_counter& operator+=(difference_type n) { return base_ += n * _row(), *this; }
+    constexpr _run_counter& operator-=(difference_type n) { return base_ -= n * _row(), *this; }
+    constexpr _run_counter& operator++() { return *this += 1; }
+    constexpr _run_counter& operator--() { return *this -= 1; }
+    constexpr _run_counter operator++(int) { return std::exchange(*this, *this + 1); }
+    constexpr _run_counter operator--(int) { return std::exchange(*this, *this - 1); }
+    constexpr friend _run_counter operator+(_run_counter c, difference_type n) { return c += n; }
+    constexpr friend _run_counter operator+(difference_type n, _run_counter c) { return c += n; }
+    constexpr friend _run_counter operator-(_run_counter c, difference_type n) { return c -= n; }
+    constexpr difference_type operator-(_run_counter const& o) const { return (base_ - o.base_) / _row(); }
+
+    constexpr value_type operator*() const { return {*base_, base_.max.back()}; }
+    constexpr value_type operator[](difference_type n) const { return *(*this + n); }
+
+    constexpr bool operator==(_run_counter const& o) const { return base_ == o.base_; }
+    constexpr auto operator<=>(_run_counter const& o) const { return base_ <=> o.base_; }
+
+private:
+    constexpr difference_type _row() const { return std::max<difference_type>(1, base_.max.back()); }
+
+private:
+    _counter<Ty_, Dim_> base_;
+};
+
+template <typename SizeTy_, size_t Dim_>
+struct _count_runs : _count_chunkable<_count_runs<SizeTy_, Dim_>> {
+    using iterator = _run_counter<SizeTy_, Dim_>;
+    constexpr iterator begin() const { return _counter<SizeTy_, Dim_>{max, 0}; }
+    constexpr iterator end() const { return _counter<SizeTy_, Dim_>{max, size() * std::max<size_t>(1, max.back())}; }
+    constexpr size_t size() const {
+        return std::reduce(max.begin(), max.end() - 1, size_t{max.back() != 0}, std::multiplies<>{});
+    }
+
+    std::array<SizeTy_, Dim_> max;
 };
 
 template <typename SizeTy_, size_t Dim_>
-struct _count_index {
+struct _count_index : _count_chunkable<_count_index<SizeTy_, Dim_>> {
     using iterator = _counter<SizeTy_, Dim_>;
     using dimension = typename iterator::dimension;
-    constexpr iterator begin() const { return _counter<SizeTy_, Dim_>{max, {}}; }
-    // constexpr iterator end() const { return _counter<SizeTy_, Dim_>{max, max}; }
-    constexpr iterator end() const { return _counter<SizeTy_, Dim_>{max, max}; }
+    constexpr iterator begin() const { return iterator{max, 0}; }
+    constexpr iterator end() const { return iterator{max, size()}; }
+    constexpr size_t size() const {
+        return std::reduce(max.begin(), max.end(), size_t{1}, std::multiplies<>{});
+    }
+
+    /**
+     * Visits same indexes in another order, e.g. to improve locality of stencil kernels.
+     * @code
+     * for (auto const& [i, j] : counter(h, w).traverse(traversal::tiled{16, 64})) { ... }
+     * for (auto [first, length] : counter(h, w).traverse(traversal::inner_run)) {
+     *     auto* row = &arr[first];
+     *     for (size_t k = 0; k < length; ++k) { row[k] = ...; } // vectorizable
+     * }
+     * @endcode
+     */
+    constexpr auto traverse(traversal::tiled<Dim_> const& policy) const {
+        using iterator = _tiled_counter<SizeTy_, Dim_>;
+        return _count_sequence<iterator>{{max, policy.tile, false}, {max, policy.tile, true}};
+    }
+
+    constexpr auto traverse(traversal::morton_t) const {
+        using iterator = _morton_counter<SizeTy_, Dim_>;
+        return _count_sequence<iterator>{{max, false}, {max, true}};
+    }
+
+    constexpr auto traverse(traversal::hilbert_t) const requires(Dim_ == 2) {
+        using iterator = _hilbert_counter<SizeTy_>;
+        return _count_sequence<iterator>{{max, false}, {max, true}};
+    }
+
+    constexpr auto traverse(traversal::inner_run_t) const { return _count_runs<SizeTy_, Dim_>{{}, max}; }
 
     dimension max;
 };
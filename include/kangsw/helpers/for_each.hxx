@@ -1,7 +1,10 @@
 #pragma once
+#include <functional>
+#include <iterator>
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 #include "counter.hxx"
 
 namespace kangsw::inline iterations {
@@ -36,42 +39,106 @@ constexpr recurse_policy_v<_recurse_policy_base::preorder> preorder;
 constexpr recurse_policy_v<_recurse_policy_base::postorder> postorder;
 } // namespace recurse
 
+template <typename Ref_>
+struct _recurse_frame {
+    // reference is wrapped to keep frames assignable
+    std::conditional_t<std::is_reference_v<Ref_>, std::reference_wrapper<std::remove_reference_t<Ref_>>, Ref_> ref;
+    size_t depth;
+    bool expanded = false;
+};
+
+/**
+ * recurse_for_each의 탐색 스택. 호출 사이에 재사용하면 매번 재할당하지 않습니다.
+ */
+template <typename Ref_>
+using recurse_stack = std::vector<_recurse_frame<Ref_>>;
+
+template <typename Ref_, typename Recurse_, typename Emplacer_>
+void _recurse_expand(Recurse_& recurse, Ref_ ref, size_t depth, Emplacer_&& emplacer) {
+    if constexpr (std::is_invocable_v<Recurse_, Ref_, void(Ref_)>) {
+        recurse(ref, emplacer);
+    }
+    else if constexpr (std::is_invocable_v<Recurse_, Ref_, size_t, void(Ref_)>) {
+        recurse(ref, depth, emplacer);
+    }
+    else {
+        static_assert(sizeof(Recurse_*) == 0, "recurse callback has invalid signature");
+    }
+}
+
+template <typename Ref_, typename Visit_>
+void _recurse_visit(Visit_& visit, Ref_ ref, size_t depth) {
+    if constexpr (std::is_invocable_v<Visit_, Ref_>) {
+        visit(ref);
+    }
+    else if constexpr (std::is_invocable_v<Visit_, Ref_, size_t>) {
+        visit(ref, depth);
+    }
+    else {
+        static_assert(sizeof(Visit_*) == 0, "visit callback has invalid signature");
+    }
+}
+
 /**
  * 재귀적으로 작업을 수행합니다.
  * @param root 루트가 되는 노드입니다.
  * @param recurse Ty_로부터 하위 노드를 추출합니다. void(Ty_& parent, void (emplacer)(Ty_&)) 시그니쳐를 갖는 콜백으로, parent의 자손 노드를 iterate해 각각의 노드에 대해 emplacer(node)를 호출하여 재귀적인 작업을 수행할 수 있습니다.
- * 
+ * @param visit void(Ty_) 또는 void(Ty_, size_t depth). preorder에서는 recurse 직전에, postorder에서는 모든 자손을 방문한 뒤에 호출됩니다. postorder에서는 필수입니다.
+ * @param stack 재사용할 탐색 스택. nullptr이면 호출마다 새로 할당합니다.
  */
 template <
   typename Ref_, typename Recurse_,
-  _recurse_policy_base Policy_ = _recurse_policy_base::preorder>
-decltype(auto) recurse_for_each(
+  _recurse_policy_base Policy_ = _recurse_policy_base::preorder,
+  typename Visit_ = std::nullptr_t>
+void recurse_for_each(
   Ref_ root, Recurse_&& recurse,
-  std::integral_constant<_recurse_policy_base, Policy_> = {}) {
-    if constexpr (Policy_ == _recurse_policy_base::preorder) {
-        std::vector<std::pair<Ref_, size_t>> stack;
-        stack.emplace_back(root, 0);
-
-        while (!stack.empty()) {
-            auto ref = stack.back();
-            stack.pop_back();
-
-            if constexpr (std::is_invocable_v<Recurse_, Ref_, void(Ref_)>) {
-                recurse(ref.first, [&stack, n = ref.second + 1](Ref_ arg) { stack.emplace_back(arg, n); });
-            }
-            else if constexpr (std::is_invocable_v<Recurse_, Ref_, size_t, void(Ref_)>) {
-                recurse(ref.first, ref.second, [&stack, n = ref.second + 1](Ref_ arg) { stack.emplace_back(arg, n); });
-            }
-            else {
-                static_assert(false);
-            }
+  std::integral_constant<_recurse_policy_base, Policy_> = {},
+  Visit_&& visit = {},
+  recurse_stack<Ref_>* stack = nullptr) {
+    constexpr bool has_visit = !std::is_same_v<std::remove_cvref_t<Visit_>, std::nullptr_t>;
+    static_assert(has_visit || Policy_ == _recurse_policy_base::preorder, "postorder traversal requires visit");
+
+    recurse_stack<Ref_> local;
+    auto& frames = stack ? *stack : local;
+    frames.clear();
+    frames.push_back({root, 0});
+
+    while (!frames.empty()) {
+        auto& top = frames.back();
+        Ref_ ref = top.ref;
+        auto depth = top.depth;
+        auto emplacer = [&frames, n = depth + 1](Ref_ arg) { frames.push_back({arg, n}); };
+
+        if constexpr (Policy_ == _recurse_policy_base::preorder) {
+            frames.pop_back();
+            if constexpr (has_visit) { _recurse_visit<Ref_>(visit, ref, depth); }
+            _recurse_expand<Ref_>(recurse, ref, depth, emplacer);
+        }
+        else if (top.expanded) {
+            frames.pop_back();
+            _recurse_visit<Ref_>(visit, ref, depth);
+        }
+        else {
+            // children are pushed above, thus this frame is visited after all of them
+            top.expanded = true;
+            _recurse_expand<Ref_>(recurse, ref, depth, emplacer);
         }
     }
-    else if constexpr (Policy_ == _recurse_policy_base::postorder) {
-        static_assert(false); // do it later
+}
+
+/**
+ * Invokes partition callback, which optionally receives partition index
+ */
+template <typename Fn_, typename Ref_>
+void _invoke_partition(Fn_&& cb, Ref_&& ref, size_t partition_index) {
+    if constexpr (std::is_invocable_v<Fn_, Ref_>) {
+        cb(std::forward<Ref_>(ref));
+    }
+    else if constexpr (std::is_invocable_v<Fn_, Ref_, size_t /*partition*/>) {
+        cb(std::forward<Ref_>(ref), partition_index);
     }
     else {
-        static_assert(false);
+        static_assert(sizeof(Fn_*) == 0, "given callback has invalid signature");
     }
 }
 
@@ -84,27 +151,28 @@ void for_each_partition(ExPo_&&, It_ first, It_ last, Fn_&& cb, size_t num_parti
     num_partitions = std::min(num_elems, num_partitions);
     iota partitions(num_partitions);
 
+    // iterators which can't jump are collected in single pass, instead of advancing per partition
+    constexpr bool random_access = std::is_base_of_v<
+      std::random_access_iterator_tag, typename std::iterator_traits<It_>::iterator_category>;
+    std::vector<It_> anchors;
+    if constexpr (!random_access) {
+        anchors.reserve(num_partitions);
+        for (size_t i = 0; i < num_partitions; ++i, std::advance(first, steps)) { anchors.push_back(first); }
+    }
+
     std::for_each(
       ExPo_{},
       partitions.begin(),
       partitions.end(),
-      [num_elems, num_partitions, steps, &cb, &first](size_t partition_index) {
-          It_ it = first, end;
+      [num_elems, num_partitions, steps, &cb, &first, &anchors](size_t partition_index) {
           size_t current_index = steps * partition_index;
-          std::advance(it, current_index);
-          std::advance(end = it, partition_index + 1 == num_partitions ? num_elems - current_index : steps);
-
-          for (; it != end; ++it) {
-              if constexpr (std::is_invocable_v<Fn_, decltype(*it)>) {
-                  cb(*it);
-              }
-              else if constexpr (std::is_invocable_v<Fn_, decltype(*it), size_t /*partition*/>) {
-                  cb(*it, partition_index);
-              }
-              else {
-                  static_assert(false, "given callback has invalid signature");
-              }
-          }
+          It_ it = [&]() -> It_ {
+              if constexpr (random_access) { return first + current_index; }
+              else { return anchors[partition_index]; }
+          }();
+          It_ end = std::next(it, ptrdiff_t(partition_index + 1 == num_partitions ? num_elems - current_index : steps));
+
+          for (; it != end; ++it) { _invoke_partition(cb, *it, partition_index); }
       });
 }
 
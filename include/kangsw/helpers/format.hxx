@@ -0,0 +1,423 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <ki6080@gmail.com> wrote this file. As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.      Seungwoo Kang.
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace kangsw::inline formatting {
+namespace _format_impl {
+
+/**
+ * Parsed printf conversion, e.g. %-08.3f
+ */
+struct spec {
+    char conv = 0;
+    bool left = false;
+    bool plus = false;
+    bool space = false;
+    bool zero = false;
+    bool alt = false;
+    int width = 0;
+    int precision = -1;
+};
+
+/**
+ * Literal text preceding each conversion. escaped is set if it contains %%
+ */
+struct literal {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    bool escaped = false;
+};
+
+enum kind : unsigned {
+    integer = 1,
+    floating = 2,
+    string = 4,
+    pointer = 8,
+};
+
+template <typename Ty_>
+consteval unsigned kind_of() {
+    using type = std::remove_cvref_t<Ty_>;
+    unsigned kinds = 0;
+    if constexpr (std::is_integral_v<type>) { kinds |= integer; }
+    if constexpr (std::is_floating_point_v<type>) { kinds |= floating; }
+    if constexpr (std::is_pointer_v<std::decay_t<type>> || std::is_null_pointer_v<type>) { kinds |= pointer; }
+    if constexpr (!std::is_null_pointer_v<type> && std::is_convertible_v<type const&, std::string_view>) { kinds |= string; }
+    return kinds;
+}
+
+consteval unsigned accepted_kinds(char conv) {
+    switch (conv) {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c': return integer;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': return floating;
+    case 's': return string;
+    case 'p': return pointer;
+    default: return 0;
+    }
+}
+
+// not constexpr, thus calling this in consteval context reports the message as compile error
+inline void format_error(char const*) {}
+
+} // namespace _format_impl
+
+/**
+ * printf-style format string, which is parsed and type-checked against arguments at compile time.
+ * Length modifiers (hh, l, ll, z, ...) are accepted and ignored, as argument types are known.
+ * Asterisk width and precision are not supported.
+ */
+template <typename... Args_>
+class basic_format_string {
+public:
+    template <typename Str_>
+    requires std::is_convertible_v<Str_ const&, std::string_view>
+    consteval basic_format_string(Str_ const& fmt) : str_(fmt) {
+        using namespace _format_impl;
+        constexpr std::array<unsigned, sizeof...(Args_) + 1> kinds = {kind_of<Args_>()..., 0};
+        std::string_view str = str_;
+        size_t pos = 0, arg = 0, literal_begin = 0;
+        bool escaped = false;
+
+        auto digits = [&] {
+            int value = 0;
+            for (; pos < str.size() && str[pos] >= '0' && str[pos] <= '9'; ++pos) { value = value * 10 + (str[pos] - '0'); }
+            return value;
+        };
+
+        while (pos < str.size()) {
+            if (str[pos] != '%') { ++pos; continue; }
+            if (pos + 1 < str.size() && str[pos + 1] == '%') { escaped = true, pos += 2; continue; }
+            if (arg == sizeof...(Args_)) { format_error("too few arguments for format string"); }
+
+            literals_[arg] = {uint32_t(literal_begin), uint32_t(pos - literal_begin), escaped};
+            escaped = false;
+            auto& s = specs_[arg];
+
+            for (++pos; pos < str.size(); ++pos) {
+                if (str[pos] == '-') { s.left = true; }
+                else if (str[pos] == '+') { s.plus = true; }
+                else if (str[pos] == ' ') { s.space = true; }
+                else if (str[pos] == '0') { s.zero = true; }
+                else if (str[pos] == '#') { s.alt = true; }
+                else { break; }
+            }
+
+            s.width = digits();
+            if (pos < str.size() && str[pos] == '.') { ++pos, s.precision = digits(); }
+            if (pos < str.size() && str[pos] == '*') { format_error("asterisk width or precision is not supported"); }
+            while (pos < str.size() && std::string_view{"hljztL"}.find(str[pos]) != std::string_view::npos) { ++pos; }
+            if (pos == str.size()) { format_error("incomplete conversion at end of format string"); }
+
+            s.conv = str[pos++];
+            if (accepted_kinds(s.conv) == 0) { format_error("unknown conversion specifier"); }
+            if ((accepted_kinds(s.conv) & kinds[arg]) == 0) { format_error("argument type does not match to conversion"); }
+
+            literal_begin = pos, ++arg;
+        }
+
+        if (arg != sizeof...(Args_)) { format_error("too many arguments for format string"); }
+        literals_[arg] = {uint32_t(literal_begin), uint32_t(str.size() - literal_begin), escaped};
+    }
+
+    std::string_view get() const { return str_; }
+
+public:
+    std::string_view str_;
+    std::array<_format_impl::spec, sizeof...(Args_)> specs_ = {};
+    std::array<_format_impl::literal, sizeof...(Args_) + 1> literals_ = {};
+};
+
+template <typename... Args_>
+using format_string = basic_format_string<std::remove_cvref_t<Args_>...>;
+
+/**
+ * Growable string which keeps first N_ characters inline, to format without allocation.
+ * Once it overflows, content moves to heap and its capacity is reused after clear().
+ */
+template <size_t N_ = 256>
+class format_buffer {
+public:
+    void append(char const* str, size_t n) {
+        if (!spilled_ && size_ + n <= N_) { std::memcpy(inline_ + size_, str, n), size_ += n; }
+        else { _spill().append(str, n); }
+    }
+
+    void fill(char ch, size_t n) {
+        if (!spilled_ && size_ + n <= N_) { std::memset(inline_ + size_, ch, n), size_ += n; }
+        else { _spill().append(n, ch); }
+    }
+
+    char const* data() const { return spilled_ ? heap_.data() : inline_; }
+    size_t size() const { return spilled_ ? heap_.size() : size_; }
+    bool empty() const { return size() == 0; }
+    void clear() { size_ = 0, heap_.clear(); }
+
+    std::string_view view() const { return {data(), size()}; }
+    operator std::string_view() const { return view(); }
+
+    std::string str() const& { return std::string{view()}; }
+    std::string str() && { return spilled_ ? std::move(heap_) : std::string{view()}; }
+
+private:
+    std::string& _spill() {
+        if (!spilled_) {
+            heap_.reserve(N_ * 2);
+            heap_.assign(inline_, size_);
+            spilled_ = true;
+        }
+        return heap_;
+    }
+
+private:
+    char inline_[N_];
+    size_t size_ = 0;
+    bool spilled_ = false;
+    std::string heap_;
+};
+
+namespace _format_impl {
+
+/**
+ * Writes into fixed buffer as long as it fits, but counts entire length
+ */
+struct span_sink {
+    void append(char const* str, size_t n) {
+        if (size < buffer.size()) { std::memcpy(buffer.data() + size, str, std::min(n, buffer.size() - size)); }
+        size += n;
+    }
+
+    void fill(char ch, size_t n) {
+        if (size < buffer.size()) { std::memset(buffer.data() + size, ch, std::min(n, buffer.size() - size)); }
+        size += n;
+    }
+
+    std::span<char> buffer;
+    size_t size = 0;
+};
+
+struct string_sink {
+    void append(char const* str, size_t n) { string.append(str, n); }
+    void fill(char ch, size_t n) { string.append(n, ch); }
+
+    std::string& string;
+};
+
+inline void to_upper(char* first, char* last) {
+    for (; first != last; ++first) {
+        if (*first >= 'a' && *first <= 'z') { *first -= 'a' - 'A'; }
+    }
+}
+
+/**
+ * Writes [prefix][zeros][body] aligned to width of the spec
+ */
+template <typename Sink_>
+void write_padded(Sink_& out, spec const& s, std::string_view prefix, size_t zeros, std::string_view body, bool zero_pad) {
+    size_t length = prefix.size() + zeros + body.size();
+    size_t pad = size_t(s.width) > length ? s.width - length : 0;
+    zero_pad = zero_pad && s.zero && !s.left;
+
+    if (!s.left && !zero_pad) { out.fill(' ', pad); }
+    if (!prefix.empty()) { out.append(prefix.data(), prefix.size()); }
+    out.fill('0', zeros + (zero_pad ? pad : 0));
+    out.append(body.data(), body.size());
+    if (s.left) { out.fill(' ', pad); }
+}
+
+template <typename Sink_>
+void write_literal(Sink_& out, std::string_view str, literal const& lit) {
+    auto text = str.substr(lit.offset, lit.length);
+    if (!lit.escaped) { return out.append(text.data(), text.size()); }
+
+    for (size_t pos; (pos = text.find('%')) != text.npos; text.remove_prefix(pos + 2)) {
+        out.append(text.data(), pos + 1);
+    }
+    out.append(text.data(), text.size());
+}
+
+template <typename Sink_, typename Ty_>
+void write_integer(Sink_& out, spec const& s, Ty_ value) {
+    if (s.conv == 'c') {
+        char ch = char(value);
+        return write_padded(out, s, {}, 0, {&ch, 1}, false);
+    }
+
+    using unsigned_type = std::make_unsigned_t<std::conditional_t<std::is_same_v<Ty_, bool>, unsigned, Ty_>>;
+    bool is_signed = s.conv == 'd' || s.conv == 'i';
+    bool negative = false;
+    unsigned_type magnitude = unsigned_type(value);
+    if constexpr (std::is_signed_v<Ty_>) {
+        if (is_signed && value < 0) { negative = true, magnitude = unsigned_type(0) - magnitude; }
+    }
+
+    int base = s.conv == 'x' || s.conv == 'X' ? 16 : s.conv == 'o' ? 8 : 10;
+    char digits[72];
+    auto end = std::to_chars(digits, std::end(digits), magnitude, base).ptr;
+    if (s.conv == 'X') { to_upper(digits, end); }
+
+    size_t num_digits = s.precision == 0 && magnitude == 0 ? 0 : end - digits;
+    size_t zeros = size_t(s.precision) > num_digits && s.precision > 0 ? s.precision - num_digits : 0;
+
+    char prefix[3];
+    size_t num_prefix = 0;
+    if (negative) { prefix[num_prefix++] = '-'; }
+    else if (is_signed && s.plus) { prefix[num_prefix++] = '+'; }
+    else if (is_signed && s.space) { prefix[num_prefix++] = ' '; }
+
+    if (s.alt && base == 16 && magnitude != 0) { prefix[num_prefix++] = '0', prefix[num_prefix++] = s.conv; }
+    else if (s.alt && base == 8 && zeros == 0 && (num_digits == 0 || digits[0] != '0')) { zeros = 1; }
+
+    write_padded(out, s, {prefix, num_prefix}, zeros, {digits, num_digits}, s.precision < 0);
+}
+
+template <typename Sink_, typename Ty_>
+void write_floating(Sink_& out, spec const& s, Ty_ value) {
+    auto lower = char(s.conv | 0x20);
+    auto format = lower == 'f' ? std::chars_format::fixed
+                : lower == 'e' ? std::chars_format::scientific
+                : lower == 'g' ? std::chars_format::general
+                               : std::chars_format::hex;
+
+    bool negative = std::signbit(value);
+    auto magnitude = std::abs(value);
+    auto convert = [&](char* first, char* last) {
+        if (lower == 'a' && s.precision < 0) { return std::to_chars(first, last, magnitude, format); }
+        return std::to_chars(first, last, magnitude, format, s.precision < 0 ? 6 : s.precision);
+    };
+
+    char prefix[3];
+    size_t num_prefix = 0;
+    if (negative) { prefix[num_prefix++] = '-'; }
+    else if (s.plus) { prefix[num_prefix++] = '+'; }
+    else if (s.space) { prefix[num_prefix++] = ' '; }
+
+    bool finite = std::isfinite(value);
+    if (lower == 'a' && finite) { prefix[num_prefix++] = '0', prefix[num_prefix++] = s.conv == 'A' ? 'X' : 'x'; }
+
+    char digits[128];
+    auto [end, ec] = convert(digits, std::end(digits));
+    if (ec == std::errc{}) {
+        if (s.conv != lower) { to_upper(digits, end); }
+        return write_padded(out, s, {prefix, num_prefix}, 0, {digits, size_t(end - digits)}, finite);
+    }
+
+    // fixed notation of large exponent, or long precision
+    std::string large(std::numeric_limits<Ty_>::max_exponent10 + std::max(s.precision, 0) + 16, '\0');
+    end = convert(large.data(), large.data() + large.size()).ptr;
+    if (s.conv != lower) { to_upper(large.data(), end); }
+    write_padded(out, s, {prefix, num_prefix}, 0, {large.data(), size_t(end - large.data())}, finite);
+}
+
+template <typename Sink_, typename Ty_>
+void write_argument(Sink_& out, spec const& s, Ty_ const& value) {
+    switch (s.conv) {
+    case 's':
+        if constexpr ((kind_of<Ty_>() & string) != 0) {
+            std::string_view str = value;
+            if (s.precision >= 0) { str = str.substr(0, s.precision); }
+            write_padded(out, s, {}, 0, str, false);
+        }
+        break;
+
+    case 'p':
+        if constexpr ((kind_of<Ty_>() & pointer) != 0) {
+            char digits[20];
+            auto end = std::to_chars(digits, std::end(digits), reinterpret_cast<uintptr_t>(static_cast<void const*>(value)), 16).ptr;
+            write_padded(out, s, "0x", 0, {digits, size_t(end - digits)}, false);
+        }
+        break;
+
+    default:
+        if constexpr (std::is_integral_v<Ty_>) { write_integer(out, s, value); }
+        else if constexpr (std::is_floating_point_v<Ty_>) { write_floating(out, s, value); }
+        break;
+    }
+}
+
+template <typename Sink_, typename... Args_>
+void format_to(Sink_& out, basic_format_string<Args_...> const& fmt, Args_ const&... args) {
+    size_t index = 0;
+    ((write_literal(out, fmt.str_, fmt.literals_[index]),
+      write_argument(out, fmt.specs_[index], args),
+      ++index),
+     ...);
+    write_literal(out, fmt.str_, fmt.literals_[index]);
+}
+
+} // namespace _format_impl
+
+namespace _format_impl {
+
+/**
+ * format and format_to are function objects rather than functions. Once unqualified lookup finds
+ * an object, argument dependent lookup is suppressed, thus std::format and std::format_to, which
+ * accept the same format strings, never join the overload set via std:: arguments and make the
+ * call ambiguous.
+ */
+struct format_to_fn {
+    /**
+     * Formats into given buffer, and returns the length of entire result.
+     * Result is truncated if the buffer is short, as snprintf does, but it is not null-terminated.
+     */
+    template <typename... Args_>
+    size_t operator()(std::span<char> buffer, format_string<Args_...> fmt, Args_&&... args) const {
+        span_sink sink{buffer};
+        format_to<span_sink, std::remove_cvref_t<Args_>...>(sink, fmt, args...);
+        return sink.size;
+    }
+
+    /**
+     * Appends formatted string to buffer, which doesn't allocate until its inline storage overflows.
+     */
+    template <size_t N_, typename... Args_>
+    format_buffer<N_>& operator()(format_buffer<N_>& buffer, format_string<Args_...> fmt, Args_&&... args) const {
+        format_to<format_buffer<N_>, std::remove_cvref_t<Args_>...>(buffer, fmt, args...);
+        return buffer;
+    }
+};
+
+struct format_fn {
+    /**
+     * Formats in single pass on stack buffer, and allocates the result at most once.
+     */
+    template <typename... Args_>
+    std::string operator()(format_string<Args_...> fmt, Args_&&... args) const {
+        format_buffer<> buffer;
+        format_to<format_buffer<>, std::remove_cvref_t<Args_>...>(buffer, fmt, args...);
+        return std::move(buffer).str();
+    }
+};
+
+} // namespace _format_impl
+
+inline constexpr _format_impl::format_to_fn format_to;
+inline constexpr _format_impl::format_fn format;
+
+/**
+ * Appends formatted string, reusing capacity of given string
+ */
+template <typename... Args_>
+std::string& append_to(std::string& str, format_string<Args_...> fmt, Args_&&... args) {
+    _format_impl::string_sink sink{str};
+    _format_impl::format_to<_format_impl::string_sink, std::remove_cvref_t<Args_>...>(sink, fmt, args...);
+    return str;
+}
+
+} // namespace kangsw::inline formatting
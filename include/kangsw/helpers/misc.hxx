@@ -15,21 +15,12 @@
 #include <thread>
 #include "kangsw/helpers/counter.hxx"
 #include "kangsw/helpers/for_each.hxx"
+#include "kangsw/helpers/format.hxx"
 #include "kangsw/helpers/trivial.hxx"
 #include "kangsw/helpers/zip.hxx"
 
 namespace kangsw {
 
-template <typename... Args_>
-std::string format(char const* fmt, Args_&&... args) {
-    std::string s;
-    auto buflen = snprintf(nullptr, 0, fmt, std::forward<Args_>(args)...);
-    s.resize(buflen);
-
-    snprintf(s.data(), buflen, fmt, std::forward<Args_>(args)...);
-    return s;
-}
-
 inline namespace iterations {
 /**
  * Executes for_each with given parallel execution policy. However, it provides current partition index within given callback.
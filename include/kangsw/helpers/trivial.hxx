@@ -1,5 +1,13 @@
 #pragma once
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <limits>
 #include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 #include <algorithm>
 #include <numeric>
@@ -104,20 +112,131 @@ void swap_remove(Container_& ct, typename Container_::size_type at) {
     ct.pop_back();
 }
 
-namespace ___internals {
-thread_local static std::vector<size_t> indexes;
+/**
+ * Key types which can be sorted by radix of their bits
+ */
+template <typename Ty_>
+concept _radix_sortable = std::is_integral_v<Ty_>
+                          || (std::is_floating_point_v<Ty_> && std::numeric_limits<Ty_>::is_iec559
+                              && (sizeof(Ty_) == sizeof(uint32_t) || sizeof(Ty_) == sizeof(uint64_t)));
+
+/**
+ * Maps key to unsigned integer of same order
+ */
+template <_radix_sortable Ty_>
+auto _radix_key(Ty_ value) {
+    if constexpr (std::is_same_v<Ty_, bool>) { return uint8_t(value); }
+    else if constexpr (std::is_integral_v<Ty_>) {
+        using key_type = std::make_unsigned_t<Ty_>;
+        auto key = key_type(value);
+        if constexpr (std::is_signed_v<Ty_>) { key ^= key_type(1) << (sizeof(Ty_) * 8 - 1); }
+        return key;
+    }
+    else {
+        using key_type = std::conditional_t<sizeof(Ty_) == sizeof(uint32_t), uint32_t, uint64_t>;
+        constexpr auto sign = key_type(1) << (sizeof(Ty_) * 8 - 1);
+        auto key = std::bit_cast<key_type>(value == Ty_{} ? Ty_{} : value); // -0 equals to +0
+        return key & sign ? key_type(~key) : key_type(key | sign);
+    }
 }
+
 /**
- * sort vectors by one vector
+ * Fills out with indexes of pivot in ascending order, by comparison.
+ * Equivalent elements keep their order, and nothing is allocated.
  */
-template <typename Pvt_, typename... Containers_>
-auto& sort_index(Pvt_& pivot) {
-    auto& indexes = ___internals::indexes;
-    std::iota(indexes.begin(), indexes.end(), std::size(pivot));
-    std::sort(indexes.begin(), indexes.end(),
-              [&pivot, pred = std::less<Pvt_>{}](size_t l, size_t r) { return pred(pivot[l], pivot[r]); });
+template <typename Pvt_, typename Pred_ = std::less<>>
+requires std::predicate<Pred_&, decltype(std::declval<Pvt_ const&>()[0]), decltype(std::declval<Pvt_ const&>()[0])>
+void sort_index(Pvt_ const& pivot, std::span<size_t> out, Pred_&& pred = {}) {
+    size_t n = std::size(pivot);
+    if (out.size() < n) { throw std::invalid_argument("index buffer is shorter than pivot"); }
+
+    out = out.first(n);
+    std::iota(out.begin(), out.end(), size_t{});
+    std::sort(out.begin(), out.end(), [&](size_t l, size_t r) {
+        return pred(pivot[l], pivot[r]) || (!pred(pivot[r], pivot[l]) && l < r);
+    });
+}
 
+/**
+ * Fills out with indexes of pivot in ascending order.
+ * Integer and floating point keys are sorted by LSD radix sort using scratch, which should be as long as pivot;
+ * other keys fall back to comparison sort. Equivalent elements keep their order in both cases.
+ */
+template <typename Pvt_>
+void sort_index(Pvt_ const& pivot, std::span<size_t> out, std::span<size_t> scratch) {
+    using key_type = std::remove_cvref_t<decltype(pivot[0])>;
+    size_t n = std::size(pivot);
+
+    // comparison sort is faster on short arrays
+    if constexpr (!_radix_sortable<key_type>) { return sort_index(pivot, out); }
+    else if (n < 64) { return sort_index(pivot, out); }
+    else {
+        if (out.size() < n || scratch.size() < n) { throw std::invalid_argument("index buffer is shorter than pivot"); }
+
+        // histograms of every digit are independent from order, thus gathered in single pass
+        constexpr size_t num_digits = sizeof(_radix_key(key_type{}));
+        std::array<std::array<size_t, 256>, num_digits> counts = {};
+        for (size_t i = 0; i < n; ++i) {
+            auto key = _radix_key(pivot[i]);
+            for (size_t d = 0; d < num_digits; ++d) { ++counts[d][(key >> d * 8) & 0xff]; }
+        }
+
+        std::iota(out.begin(), out.begin() + n, size_t{});
+        auto src = out.data(), dst = scratch.data();
+        auto first_key = _radix_key(pivot[0]);
+
+        for (size_t d = 0; d < num_digits; ++d) {
+            auto& offsets = counts[d];
+            if (offsets[(first_key >> d * 8) & 0xff] == n) { continue; } // every key has same digit
+
+            std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(), size_t{});
+            for (size_t i = 0; i < n; ++i) {
+                auto index = src[i];
+                dst[offsets[(_radix_key(pivot[index]) >> d * 8) & 0xff]++] = index;
+            }
+            std::swap(src, dst);
+        }
+
+        if (src != out.data()) { std::copy(src, src + n, out.data()); }
+    }
+}
+
+/**
+ * Returns indexes of pivot in ascending order
+ */
+template <typename Pvt_>
+std::vector<size_t> sort_index(Pvt_ const& pivot) {
+    std::vector<size_t> indexes(std::size(pivot)), scratch(indexes.size());
+    sort_index(pivot, indexes, scratch);
     return indexes;
 }
 
+/**
+ * Reorders containers in place, as the i-th element becomes the perm[i]-th one before.
+ * It follows cycles of permutation, thus each element is moved once without extra storage.
+ * perm is marked during the process, and restored when it returns.
+ */
+template <typename... Containers_>
+void apply_permutation(std::span<size_t> perm, Containers_&&... containers) {
+    constexpr auto visited = ~(~size_t{} >> 1);
+    if (((std::size(containers) < perm.size()) || ...)) { throw std::invalid_argument("container is shorter than permutation"); }
+
+    for (size_t i = 0; i < perm.size(); ++i) {
+        if (perm[i] & visited) { continue; }
+        if (perm[i] == i) { continue; }
+
+        auto hold = std::make_tuple(std::move(containers[i])...);
+        size_t at = i;
+        for (size_t from; (from = perm[at]) != i; at = from) {
+            ((containers[at] = std::move(containers[from])), ...);
+            perm[at] |= visited;
+        }
+
+        std::apply([&](auto&... held) { ((containers[at] = std::move(held)), ...); }, hold);
+        perm[at] |= visited;
+    }
+
+    for (auto& index : perm) { index &= ~visited; }
+}
+
 } // namespace kangsw::inline trivial
\ No newline at end of file
@@ -7,8 +7,13 @@
  * ----------------------------------------------------------------------------
  */
 #pragma once
+#include <compare>
+#include <iterator>
+#include <ranges>
 #include <stdexcept>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include "tuple_for_each.hxx"
 
 /**
@@ -27,20 +32,66 @@
 namespace kangsw::inline zipper {
 namespace _zip_impl {
 
-template <typename... Args_>
+/**
+ * Tuple of references which zip iterator yields. Assignment writes through the references.
+ * It has common reference with tuple of values, thus zip iterator models std::random_access_iterator.
+ */
+template <typename... Refs_>
+class _zip_reference : public std::tuple<Refs_...> {
+public:
+    using base_type = std::tuple<Refs_...>;
+    using base_type::base_type;
+
+    _zip_reference(base_type const& refs) : base_type(refs) {}
+
+    // binds references to elements of non-const tuple, which C++20 tuple doesn't
+    template <typename... Tys_>
+    requires(sizeof...(Tys_) == sizeof...(Refs_) && !std::is_same_v<std::tuple<Tys_...>, base_type>)
+    _zip_reference(std::tuple<Tys_...>& values)
+        : _zip_reference(values, std::index_sequence_for<Tys_...>{}) {}
+
+    // writes through the references even if this is const, as std::indirectly_writable requires
+    template <typename Tuple_>
+    requires(std::tuple_size_v<std::remove_cvref_t<Tuple_>> == sizeof...(Refs_))
+    _zip_reference const& operator=(Tuple_&& values) const {
+        _assign(std::forward<Tuple_>(values), std::index_sequence_for<Refs_...>{});
+        return *this;
+    }
+
+    _zip_reference const& operator=(_zip_reference const& other) const {
+        _assign(other, std::index_sequence_for<Refs_...>{});
+        return *this;
+    }
+
+private:
+    template <typename Tuple_, size_t... N_>
+    _zip_reference(Tuple_& values, std::index_sequence<N_...>) : base_type(std::get<N_>(values)...) {}
+
+    template <typename Tuple_, size_t... N_>
+    void _assign(Tuple_&& values, std::index_sequence<N_...>) const {
+        ((std::get<N_>(static_cast<base_type const&>(*this)) = std::get<N_>(std::forward<Tuple_>(values))), ...);
+    }
+};
+
+/**
+ * Checked_ iterator compares every packed iterator to detect ranges of different lengths.
+ * Unchecked one compares only the first, which lets the compiler vectorize zipped loops;
+ * lengths are checked once when the range is made.
+ */
+template <bool Checked_, typename... Args_>
 class _zip_iterator {
 public:
     using tuple_type = std::tuple<Args_...>;
     using iterator_category = std::random_access_iterator_tag;
-    using value_type = std::tuple<std::remove_reference_t<decltype(*Args_{})>...>;
+    using value_type = std::tuple<std::iter_value_t<Args_>...>;
     using difference_type = ptrdiff_t;
-    using reference = std::tuple<decltype(*Args_{})...>;
-    using pointer = value_type*;
+    using reference = _zip_reference<std::iter_reference_t<Args_>...>;
+    using pointer = void;
 
 private:
     template <size_t... N_>
     reference _deref(std::index_sequence<N_...>) const {
-        return std::forward_as_tuple(*std::get<N_>(pack_)...);
+        return reference{*std::get<N_>(pack_)...};
     }
 
     template <size_t N_ = 0>
@@ -60,7 +111,8 @@ private:
 
 public:
     bool operator==(_zip_iterator const& op) const {
-        return _compare_strict(op, std::get<0>(op.pack_) == std::get<0>(pack_));
+        if constexpr (Checked_) { return _compare_strict(op, std::get<0>(op.pack_) == std::get<0>(pack_)); }
+        else { return std::get<0>(op.pack_) == std::get<0>(pack_); }
     }
     bool operator!=(_zip_iterator const& op) const { return !(*this == op); }
 
@@ -99,10 +151,15 @@ public:
     friend _zip_iterator operator+(difference_type n, _zip_iterator c) { return c + n; }
     friend _zip_iterator operator-(difference_type n, _zip_iterator c) { return c - n; }
 
-    difference_type operator-(_zip_iterator o) const { return std::get<0>(pack_) - std::get<0>(o.pack_); }
+    // packed iterators move together, thus the first one represents the position
+    difference_type operator-(_zip_iterator const& o) const
+    requires(std::sized_sentinel_for<Args_, Args_> && ...) { return std::get<0>(pack_) - std::get<0>(o.pack_); }
 
-    bool operator<(_zip_iterator o) const { return std::get<0>(pack_) < std::get<0>(o.pack_); }
-    bool operator>(_zip_iterator o) const { return o < *this; }
+    auto operator<=>(_zip_iterator const& o) const {
+        auto &lhs = std::get<0>(pack_), &rhs = std::get<0>(o.pack_);
+        if constexpr (std::three_way_comparable<std::tuple_element_t<0, tuple_type>>) { return lhs <=> rhs; }
+        else { return lhs < rhs ? std::strong_ordering::less : rhs < lhs ? std::strong_ordering::greater : std::strong_ordering::equal; }
+    }
 
     reference operator[](difference_type n) const { return *(*this + n); }
 
@@ -110,15 +167,40 @@ public:
     tuple_type pack_;
 };
 
-template <typename... Args_>
-class _zip_range : public std::ranges::view_interface<_zip_range<Args_...>> {
+template <bool Checked_, typename... Args_>
+class _zip_range : public std::ranges::view_interface<_zip_range<Checked_, Args_...>> {
 public:
     using tuple_type = std::tuple<Args_...>;
-    using iterator = _zip_iterator<Args_...>;
-    using const_iterator = _zip_iterator<Args_...>;
+    using iterator = _zip_iterator<Checked_, Args_...>;
+    using const_iterator = _zip_iterator<Checked_, Args_...>;
+
+    iterator begin() const { return {begin_}; }
+    iterator end() const { return {end_}; }
 
-    _zip_iterator<Args_...> begin() const { return {begin_}; }
-    _zip_iterator<Args_...> end() const { return {end_}; }
+    /**
+     * Number of zipped elements. Checked range verifies every packed range has the same length.
+     */
+    size_t size() const
+    requires(std::sized_sentinel_for<Args_, Args_> && ...) {
+        auto size = std::get<0>(end_) - std::get<0>(begin_);
+        if constexpr (Checked_) {
+            [&]<size_t... N_>(std::index_sequence<N_...>) {
+                if (((std::get<N_>(end_) - std::get<N_>(begin_) != size) || ...)) {
+                    throw std::invalid_argument("packed tuples has difference lengths");
+                }
+            }(std::index_sequence_for<Args_...>{});
+        }
+        return size_t(size);
+    }
+
+    /**
+     * Zipped range of [first, last) elements in constant time, e.g. to split work over threads.
+     */
+    _zip_range subrange(size_t first, size_t last) const
+    requires(std::random_access_iterator<Args_> && ...) {
+        if (first > last || last > size()) { throw std::out_of_range("zip subrange out of range"); }
+        return {{}, (begin() + first).pack_, (begin() + last).pack_};
+    }
 
 public:
     tuple_type begin_;
@@ -130,6 +212,16 @@ decltype(auto) _container_size(Ty_&& container, Ph_...) {
     return std::size(container);
 }
 
+/**
+ * End of range as iterator, even if the range has distinct sentinel type.
+ * It is constant time for sized random access ranges.
+ */
+template <typename Range_>
+auto _end_iterator(Range_&& range) {
+    if constexpr (std::ranges::common_range<Range_>) { return std::ranges::end(range); }
+    else { return std::ranges::next(std::ranges::begin(range), std::ranges::end(range)); }
+}
+
 } // namespace _zip_impl
 
 template <typename Ty_>
@@ -140,12 +232,26 @@ decltype(auto) il(std::initializer_list<Ty_> v) { return v; }
  */
 template <typename... Containers_>
 decltype(auto) zip(Containers_&&... containers) {
-    auto begin = std::make_tuple(std::begin(containers)...);
-    auto end = std::make_tuple(std::end(containers)...);
+    _zip_impl::_zip_range<true, decltype(std::ranges::begin(containers))...> zips;
+    zips.begin_ = std::make_tuple(std::ranges::begin(containers)...);
+    zips.end_ = std::make_tuple(_zip_impl::_end_iterator(containers)...);
+    return zips;
+}
 
-    _zip_impl::_zip_range<decltype(std::begin(containers))...> zips;
-    zips.begin_ = begin;
-    zips.end_ = end;
+/**
+ * zip() which checks lengths only once here, instead of on every comparison.
+ * Use it for hot loops, which the compiler can vectorize then.
+ */
+template <typename... Containers_>
+decltype(auto) zip_unchecked(Containers_&&... containers) {
+    auto const size = std::ranges::distance(std::get<0>(std::forward_as_tuple(containers...)));
+    if (((std::ranges::distance(containers) != size) || ...)) {
+        throw std::invalid_argument("packed tuples has difference lengths");
+    }
+
+    _zip_impl::_zip_range<false, decltype(std::ranges::begin(containers))...> zips;
+    zips.begin_ = std::make_tuple(std::ranges::begin(containers)...);
+    zips.end_ = std::make_tuple(_zip_impl::_end_iterator(containers)...);
     return zips;
 }
 
@@ -153,6 +259,24 @@ decltype(auto) zip(Containers_&&... containers) {
 
 // tuple overload to receive swap ...
 namespace std {
+template <typename... Refs_>
+struct tuple_size<kangsw::_zip_impl::_zip_reference<Refs_...>> : integral_constant<size_t, sizeof...(Refs_)> {};
+
+template <size_t N_, typename... Refs_>
+struct tuple_element<N_, kangsw::_zip_impl::_zip_reference<Refs_...>> : tuple_element<N_, tuple<Refs_...>> {};
+
+template <typename... Refs_, typename... Vals_, template <typename> typename TQual_, template <typename> typename UQual_>
+requires(sizeof...(Refs_) == sizeof...(Vals_))
+struct basic_common_reference<kangsw::_zip_impl::_zip_reference<Refs_...>, tuple<Vals_...>, TQual_, UQual_> {
+    using type = kangsw::_zip_impl::_zip_reference<common_reference_t<TQual_<Refs_>, UQual_<Vals_>>...>;
+};
+
+template <typename... Vals_, typename... Refs_, template <typename> typename TQual_, template <typename> typename UQual_>
+requires(sizeof...(Refs_) == sizeof...(Vals_))
+struct basic_common_reference<tuple<Vals_...>, kangsw::_zip_impl::_zip_reference<Refs_...>, TQual_, UQual_> {
+    using type = kangsw::_zip_impl::_zip_reference<common_reference_t<TQual_<Vals_>, UQual_<Refs_>>...>;
+};
+
 template <typename... Args_>
 requires(is_reference_v<Args_>&&...)                                      //
   void swap(std::tuple<Args_...> const& a, std::tuple<Args_...> const& b) //
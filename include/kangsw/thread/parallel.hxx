@@ -0,0 +1,526 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <ki6080@gmail.com> wrote this file. As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.      Seungwoo Kang.
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <execution>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "kangsw/helpers/for_each.hxx"
+#include "kangsw/thread/spinlock.hxx"
+#include "kangsw/thread/thread_pool.hxx"
+#include "kangsw/thread/thread_utility.hxx"
+
+namespace kangsw::inline iterations {
+/**
+ * Scheduler of single for_each_partition call on thread_pool.
+ *
+ * Range is divided into chunks of grain size. Each participant owns a lane of chunk ranges;
+ * it splits a range in half until single chunk remains, leaving upper halves in its lane.
+ * Idle participants steal the oldest, thus the largest range from other lanes.
+ *
+ * Shared by the caller and helper tasks. Helpers which start late, after every chunk is done,
+ * only touch this state, thus the caller doesn't wait for them.
+ */
+template <typename It_, typename Fn_>
+class _steal_scheduler {
+public:
+    static constexpr bool random_access = std::is_base_of_v<
+      std::random_access_iterator_tag, typename std::iterator_traits<It_>::iterator_category>;
+
+    struct chunk_range {
+        size_t begin, end;
+    };
+
+    // a lane holds at most one range per split depth, thus 64 is enough for any size_t range
+    struct alignas(cache_line_size) lane_t {
+        spinlock lock;
+        std::array<chunk_range, 64> ranges;
+        std::atomic_size_t head = 0, tail = 0; // modified under the lock, peeked without it
+    };
+
+public:
+    _steal_scheduler(It_ first, size_t num_elems, size_t grain, size_t num_lanes, Fn_& cb)
+        : first_(first), num_elems_(num_elems), grain_(grain), cb_(&cb), lanes_(num_lanes) {
+        num_chunks_ = (num_elems_ + grain_ - 1) / grain_;
+        if constexpr (!random_access) {
+            anchors_.reserve(num_chunks_);
+            for (size_t i = 0; i < num_chunks_; ++i) {
+                anchors_.push_back(first);
+                if (i + 1 < num_chunks_) { std::advance(first, grain_); }
+            }
+        }
+
+        _push(0, {0, num_chunks_});
+    }
+
+    /**
+     * Processes chunks until whole range is done. Rethrows first exception of callback on the caller.
+     */
+    void participate(size_t lane) {
+        for (chunk_range range;;) {
+            if (!_pop(lane, range) && !_steal(lane, range)) {
+                if (num_done_.load(std::memory_order_acquire) == num_elems_) { return; }
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (; range.end - range.begin > 1;) {
+                auto mid = range.begin + (range.end - range.begin) / 2;
+                _push(lane, {mid, range.end});
+                range.end = mid;
+            }
+
+            _run_chunk(range.begin, lane);
+        }
+    }
+
+    void rethrow_if_failed() {
+        if (error_) { std::rethrow_exception(error_); }
+    }
+
+private:
+    void _run_chunk(size_t chunk, size_t lane) {
+        auto offset = chunk * grain_;
+        auto count = std::min(grain_, num_elems_ - offset);
+
+        if (!failed_.load(std::memory_order_relaxed)) {
+            try {
+                It_ it = [&]() -> It_ {
+                    if constexpr (random_access) { return first_ + offset; }
+                    else { return anchors_[chunk]; }
+                }();
+
+                for (size_t i = 0; i < count; ++i, ++it) { _invoke_partition(*cb_, *it, lane); }
+            } catch (...) {
+                std::lock_guard lock{error_lock_};
+                if (!error_) { error_ = std::current_exception(); }
+                failed_.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        num_done_.fetch_add(count, std::memory_order_acq_rel);
+    }
+
+    void _push(size_t lane, chunk_range range) {
+        auto& l = lanes_[lane];
+        std::lock_guard lock{l.lock};
+        auto tail = l.tail.load(std::memory_order_relaxed);
+        l.ranges[tail % l.ranges.size()] = range;
+        l.tail.store(tail + 1, std::memory_order_relaxed);
+    }
+
+    bool _pop(size_t lane, chunk_range& range) {
+        auto& l = lanes_[lane];
+        std::lock_guard lock{l.lock};
+        auto tail = l.tail.load(std::memory_order_relaxed);
+        if (l.head.load(std::memory_order_relaxed) == tail) { return false; }
+        l.tail.store(--tail, std::memory_order_relaxed);
+        return range = l.ranges[tail % l.ranges.size()], true;
+    }
+
+    bool _steal(size_t thief, chunk_range& range) {
+        for (size_t i = 1; i < lanes_.size(); ++i) {
+            auto& l = lanes_[(thief + i) % lanes_.size()];
+            if (l.head.load(std::memory_order_relaxed) == l.tail.load(std::memory_order_relaxed)) { continue; }
+
+            std::lock_guard lock{l.lock};
+            auto head = l.head.load(std::memory_order_relaxed);
+            if (head == l.tail.load(std::memory_order_relaxed)) { continue; }
+            l.head.store(head + 1, std::memory_order_relaxed);
+            return range = l.ranges[head % l.ranges.size()], true;
+        }
+        return false;
+    }
+
+private:
+    It_ first_;
+    size_t num_elems_;
+    size_t grain_;
+    size_t num_chunks_ = 0;
+    Fn_* cb_;
+
+    std::vector<It_> anchors_;
+    std::vector<lane_t> lanes_;
+
+    alignas(cache_line_size) std::atomic_size_t num_done_ = 0;
+    std::atomic_bool failed_ = false;
+    std::mutex error_lock_;
+    std::exception_ptr error_;
+};
+
+/**
+ * Runs for_each on thread_pool, balancing uneven workloads by work stealing.
+ *
+ * Calling thread participates as partition 0, and up to pool.num_workers() tasks help it.
+ * Callback may receive partition index as second argument, which is unique among
+ * concurrent invocations, thus can index per-thread storage of size num_partitions().
+ *
+ * @param grain number of elements which are processed without scheduling. 0 selects one
+ *      which divides range into 8 chunks per participant.
+ */
+template <typename It_, typename Fn_>
+void for_each_partition(thread_pool& pool, It_ first, It_ last, Fn_&& cb, size_t grain = 0) {
+    size_t num_elems = std::distance(first, last);
+    if (num_elems == 0) { return; }
+
+    auto num_lanes = std::min(pool.num_workers() + 1, num_elems);
+    if (grain == 0) { grain = std::max<size_t>(1, num_elems / (num_lanes * 8)); }
+    num_lanes = std::min(num_lanes, (num_elems + grain - 1) / grain);
+
+    using scheduler_type = _steal_scheduler<It_, std::remove_reference_t<Fn_>>;
+    auto scheduler = std::make_shared<scheduler_type>(first, num_elems, grain, num_lanes, cb);
+
+    try {
+        for (size_t lane = 1; lane < num_lanes; ++lane) {
+            pool.add_task([scheduler, lane] { scheduler->participate(lane); });
+        }
+    } catch (thread_pool_exception&) {
+        // queue is full; the caller still processes every chunk by itself
+    }
+
+    scheduler->participate(0);
+    scheduler->rethrow_if_failed();
+}
+
+template <typename Range_, typename Fn_>
+void for_each_partition(thread_pool& pool, Range_&& range, Fn_&& cb, size_t grain = 0) {
+    for_each_partition(pool, std::begin(range), std::end(range), std::forward<Fn_>(cb), grain);
+}
+
+/**
+ * Upper bound of partition index which for_each_partition on given pool passes, exclusive.
+ */
+inline size_t num_partitions(thread_pool const& pool) { return pool.num_workers() + 1; }
+
+/**
+ * Scheduler of single parallel recurse_for_each call on thread_pool.
+ *
+ * Each participant expands nodes on its local stack. When the stack grows over threshold,
+ * its bottom half, which holds the shallowest and usually the largest subtrees, is donated
+ * as a batch to the participant's lane, where idle participants steal it from.
+ *
+ * pending counts donated batches and busy participants, thus it becomes zero only after
+ * every node is expanded.
+ */
+template <typename Ref_, typename Recurse_>
+class _recurse_scheduler {
+public:
+    struct alignas(cache_line_size) lane_t {
+        spinlock lock;
+        std::vector<recurse_stack<Ref_>> batches;
+        std::atomic_size_t num_batches = 0;
+    };
+
+public:
+    _recurse_scheduler(Recurse_& recurse, size_t num_lanes, size_t threshold)
+        : recurse_(&recurse), threshold_(std::max<size_t>(threshold, 2)), lanes_(num_lanes) {}
+
+    /**
+     * Caller starts busy with the root on its frames; helpers start idle.
+     */
+    void participate(size_t lane, recurse_stack<Ref_>& frames, bool busy) {
+        if (!busy && !_take(lane, frames)) { return; }
+
+        for (;;) {
+            while (!frames.empty()) {
+                Ref_ ref = frames.back().ref;
+                auto depth = frames.back().depth;
+                frames.pop_back();
+
+                if (!failed_.load(std::memory_order_relaxed)) {
+                    try {
+                        auto emplacer = [&frames, n = depth + 1](Ref_ arg) { frames.push_back({arg, n}); };
+                        _recurse_expand<Ref_>(*recurse_, ref, depth, emplacer);
+                    } catch (...) {
+                        std::lock_guard lock{error_lock_};
+                        if (!error_) { error_ = std::current_exception(); }
+                        failed_.store(true, std::memory_order_relaxed);
+                    }
+                }
+
+                if (frames.size() > threshold_ && lanes_.size() > 1) { _donate(lane, frames); }
+            }
+
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+            if (!_take(lane, frames)) { return; }
+        }
+    }
+
+    void rethrow_if_failed() {
+        if (error_) { std::rethrow_exception(error_); }
+    }
+
+private:
+    void _donate(size_t lane, recurse_stack<Ref_>& frames) {
+        auto half = frames.begin() + frames.size() / 2;
+        recurse_stack<Ref_> batch(std::make_move_iterator(frames.begin()), std::make_move_iterator(half));
+        frames.erase(frames.begin(), half);
+
+        pending_.fetch_add(1, std::memory_order_acq_rel);
+        auto& l = lanes_[lane];
+        std::lock_guard lock{l.lock};
+        l.batches.push_back(std::move(batch));
+        l.num_batches.store(l.batches.size(), std::memory_order_relaxed);
+    }
+
+    /**
+     * Waits for a batch from own lane or others, until nothing is pending.
+     * Taking a batch turns it into a busy participant, thus pending is kept as is.
+     */
+    bool _take(size_t lane, recurse_stack<Ref_>& frames) {
+        for (;;) {
+            for (size_t i = 0; i < lanes_.size(); ++i) {
+                auto& l = lanes_[(lane + i) % lanes_.size()];
+                if (l.num_batches.load(std::memory_order_relaxed) == 0) { continue; }
+
+                std::lock_guard lock{l.lock};
+                if (l.batches.empty()) { continue; }
+                frames.assign(std::make_move_iterator(l.batches.back().begin()), std::make_move_iterator(l.batches.back().end()));
+                l.batches.pop_back();
+                l.num_batches.store(l.batches.size(), std::memory_order_relaxed);
+                return true;
+            }
+
+            if (pending_.load(std::memory_order_acquire) == 0) { return false; }
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    Recurse_* recurse_;
+    size_t threshold_;
+    std::vector<lane_t> lanes_;
+
+    alignas(cache_line_size) std::atomic_size_t pending_ = 1;
+    std::atomic_bool failed_ = false;
+    std::mutex error_lock_;
+    std::exception_ptr error_;
+};
+
+/**
+ * Parallel preorder recurse_for_each, which fans subtrees out to thread_pool.
+ * recurse is invoked concurrently, thus it should be thread safe. Visiting order among
+ * subtrees is unspecified.
+ *
+ * @param threshold local stack size over which half of it is handed to other workers.
+ * @param stack reusable stack of calling thread.
+ */
+template <typename Ref_, typename Recurse_>
+void recurse_for_each(
+  thread_pool& pool, Ref_ root, Recurse_&& recurse,
+  size_t threshold = 256, recurse_stack<Ref_>* stack = nullptr) {
+    using scheduler_type = _recurse_scheduler<Ref_, std::remove_reference_t<Recurse_>>;
+    auto num_lanes = num_partitions(pool);
+    auto scheduler = std::make_shared<scheduler_type>(recurse, num_lanes, threshold);
+
+    try {
+        for (size_t lane = 1; lane < num_lanes; ++lane) {
+            pool.add_task([scheduler, lane] {
+                recurse_stack<Ref_> frames;
+                scheduler->participate(lane, frames, false);
+            });
+        }
+    } catch (thread_pool_exception&) {
+        // queue is full; the caller still visits every node by itself
+    }
+
+    recurse_stack<Ref_> local;
+    auto& frames = stack ? *stack : local;
+    frames.clear();
+    frames.push_back({root, 0});
+    scheduler->participate(0, frames, true);
+    scheduler->rethrow_if_failed();
+}
+
+/**
+ * Value which occupies its own cache line, to keep partial results of parallel blocks apart.
+ */
+template <typename Ty_>
+struct alignas(cache_line_size) _padded {
+    Ty_ value;
+};
+
+/**
+ * Parallel algorithms below divide a range into blocks, process blocks on given executor which
+ * is either an execution policy or a thread_pool, then combine per-block results in order.
+ * Thus reduction operators need to be associative, but not commutative.
+ */
+template <typename Exec_>
+concept _parallel_executor = std::is_same_v<std::remove_cvref_t<Exec_>, thread_pool>
+                             || std::is_execution_policy_v<std::remove_cvref_t<Exec_>>;
+
+inline size_t _num_blocks(thread_pool& pool, size_t num_elems) {
+    // several blocks per participant, thus faster ones take more of them
+    return std::min(num_elems, num_partitions(pool) * 4);
+}
+
+template <typename ExPo_>
+requires std::is_execution_policy_v<std::remove_cvref_t<ExPo_>>
+size_t _num_blocks(ExPo_&&, size_t num_elems) {
+    return std::min<size_t>(num_elems, std::max(1u, std::thread::hardware_concurrency()) * 4);
+}
+
+template <typename Fn_>
+void _for_each_block(thread_pool& pool, size_t num_blocks, Fn_&& fn) {
+    for_each_partition(pool, iota<size_t>{num_blocks}, fn, 1);
+}
+
+template <typename ExPo_, typename Fn_>
+requires std::is_execution_policy_v<std::remove_cvref_t<ExPo_>>
+void _for_each_block(ExPo_&& policy, size_t num_blocks, Fn_&& fn) {
+    iota<size_t> blocks{num_blocks};
+    std::for_each(std::forward<ExPo_>(policy), blocks.begin(), blocks.end(), fn);
+}
+
+/**
+ * Collects beginning of every block, and the end, in single pass.
+ */
+template <typename It_>
+std::vector<It_> _block_anchors(It_ first, size_t num_elems, size_t num_blocks) {
+    std::vector<It_> anchors;
+    anchors.reserve(num_blocks + 1);
+    for (size_t block = 0, offset = 0; block <= num_blocks; ++block) {
+        auto next = num_elems * block / num_blocks;
+        std::advance(first, next - offset), offset = next;
+        anchors.push_back(first);
+    }
+    return anchors;
+}
+
+/**
+ * Reduces transformed elements, as std::transform_reduce does.
+ * Elements are combined in order: init, then each block from first to last.
+ */
+template <typename Exec_, typename It_, typename Ty_, typename ReduceOp_, typename TransformOp_>
+requires _parallel_executor<Exec_>
+Ty_ parallel_transform_reduce(
+  Exec_&& exec, It_ first, It_ last, Ty_ init, ReduceOp_ reduce, TransformOp_ transform) //
+{
+    size_t num_elems = std::distance(first, last);
+    if (num_elems == 0) { return init; }
+
+    auto num_blocks = _num_blocks(exec, num_elems);
+    auto anchors = _block_anchors(first, num_elems, num_blocks);
+    std::vector<_padded<std::optional<Ty_>>> partials(num_blocks);
+
+    _for_each_block(exec, num_blocks, [&](size_t block) {
+        auto it = anchors[block], end = anchors[block + 1];
+        Ty_ value = transform(*it);
+        while (++it != end) { value = reduce(std::move(value), transform(*it)); }
+        partials[block].value.emplace(std::move(value));
+    });
+
+    for (auto& partial : partials) { init = reduce(std::move(init), std::move(*partial.value)); }
+    return init;
+}
+
+template <typename Exec_, typename It_, typename Ty_, typename ReduceOp_ = std::plus<>>
+requires _parallel_executor<Exec_>
+Ty_ parallel_reduce(Exec_&& exec, It_ first, It_ last, Ty_ init, ReduceOp_ reduce = {}) {
+    return parallel_transform_reduce(
+      std::forward<Exec_>(exec), first, last, std::move(init), std::move(reduce),
+      [](auto&& elem) -> decltype(auto) { return std::forward<decltype(elem)>(elem); });
+}
+
+/**
+ * Writes inclusive prefix sums of [first, last) into d_first, as std::inclusive_scan does.
+ * Reduces each block, scans block sums sequentially, then scans each block with its carry.
+ * Output may alias input.
+ * @return end of output
+ */
+template <typename Exec_, typename It_, typename OutIt_, typename ReduceOp_ = std::plus<>>
+requires _parallel_executor<Exec_>
+OutIt_ parallel_inclusive_scan(Exec_&& exec, It_ first, It_ last, OutIt_ d_first, ReduceOp_ reduce = {}) {
+    using value_type = typename std::iterator_traits<It_>::value_type;
+    size_t num_elems = std::distance(first, last);
+    if (num_elems == 0) { return d_first; }
+
+    auto num_blocks = _num_blocks(exec, num_elems);
+    auto anchors = _block_anchors(first, num_elems, num_blocks);
+    auto out_anchors = _block_anchors(d_first, num_elems, num_blocks);
+    std::vector<_padded<std::optional<value_type>>> partials(num_blocks);
+
+    // last block's sum is never used as carry
+    _for_each_block(exec, num_blocks - 1, [&](size_t block) {
+        auto it = anchors[block], end = anchors[block + 1];
+        value_type value = *it;
+        while (++it != end) { value = reduce(std::move(value), *it); }
+        partials[block].value.emplace(std::move(value));
+    });
+
+    for (size_t block = 1; block < num_blocks - 1; ++block) {
+        partials[block].value = reduce(*partials[block - 1].value, std::move(*partials[block].value));
+    }
+
+    _for_each_block(exec, num_blocks, [&](size_t block) {
+        auto it = anchors[block], end = anchors[block + 1];
+        auto out = out_anchors[block];
+        value_type value = block ? reduce(*partials[block - 1].value, *it) : value_type(*it);
+        for (*out = value; ++it != end;) { *++out = value = reduce(std::move(value), *it); }
+    });
+
+    return out_anchors.back();
+}
+
+/**
+ * Sorts random access range. Sorts blocks in parallel, then merges pairs of adjacent runs
+ * in parallel rounds, ping-ponging between the range and a buffer.
+ */
+template <typename Exec_, typename It_, typename Compare_ = std::less<>>
+requires _parallel_executor<Exec_>
+void parallel_sort(Exec_&& exec, It_ first, It_ last, Compare_ comp = {}) {
+    using value_type = typename std::iterator_traits<It_>::value_type;
+    size_t num_elems = std::distance(first, last);
+    auto num_blocks = _num_blocks(exec, num_elems / 1024);
+    if (num_blocks <= 1) { return std::sort(first, last, comp); }
+
+    std::vector<size_t> bounds(num_blocks + 1);
+    for (size_t block = 0; block <= num_blocks; ++block) { bounds[block] = num_elems * block / num_blocks; }
+
+    _for_each_block(exec, num_blocks, [&](size_t block) {
+        std::sort(first + bounds[block], first + bounds[block + 1], comp);
+    });
+
+    std::vector<value_type> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    bool in_buffer = true;
+
+    for (size_t width = 1; width < num_blocks; width *= 2, in_buffer = !in_buffer) {
+        auto num_merges = (num_blocks + 2 * width - 1) / (2 * width);
+        _for_each_block(exec, num_merges, [&](size_t merge) {
+            auto lo = bounds[merge * 2 * width];
+            auto mid = bounds[std::min(num_blocks, merge * 2 * width + width)];
+            auto hi = bounds[std::min(num_blocks, merge * 2 * width + 2 * width)];
+            auto src = buffer.begin();
+
+            if (in_buffer) {
+                std::merge(std::make_move_iterator(src + lo), std::make_move_iterator(src + mid),
+                           std::make_move_iterator(src + mid), std::make_move_iterator(src + hi),
+                           first + lo, comp);
+            }
+            else {
+                std::merge(std::make_move_iterator(first + lo), std::make_move_iterator(first + mid),
+                           std::make_move_iterator(first + mid), std::make_move_iterator(first + hi),
+                           src + lo, comp);
+            }
+        });
+    }
+
+    if (in_buffer) { std::move(buffer.begin(), buffer.end(), first); }
+}
+
+} // namespace kangsw::inline iterations
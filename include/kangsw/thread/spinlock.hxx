@@ -8,25 +8,68 @@
  */
 #pragma once
 #include <atomic>
+#include <cstdint>
 #include <thread>
+#include "kangsw/thread/thread_utility.hxx"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
 
 namespace kangsw:: inline threads {
+/**
+ * Issues X86 PAUSE or ARM YIELD instruction, which hints spin-wait loop to the core
+ * without giving up the time slice.
+ */
+inline void cpu_relax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * Exponential backoff for spin-wait loops.
+ * Each call doubles the number of pause instructions, and yields the thread once the budget is used up,
+ * thus waiters don't hammer the cache line nor burn the time slice of lock holder.
+ */
+class backoff {
+public:
+    static constexpr uint32_t max_spins = 256;
+
+    void operator()() noexcept {
+        if (spins_ <= max_spins) {
+            for (uint32_t i = 0; i < spins_; ++i) { cpu_relax(); }
+            spins_ <<= 1;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    void reset() noexcept { spins_ = 1; }
+
+private:
+    uint32_t spins_ = 1;
+};
+
 //! @see https://rigtorp.se/spinlock/
 //! Applied slight modification to use atomic_flag
 struct spinlock {
     std::atomic_flag lock_;
 
     void lock() noexcept {
-        for (;;) {
+        for (backoff wait;;) {
             // Optimistically assume the lock is free on the first try
             if (!lock_.test_and_set(std::memory_order_acquire)) {
                 return;
             }
             // Wait for lock to be released without generating cache misses
             while (lock_.test(std::memory_order_relaxed)) {
-                // Issue X86 PAUSE or ARM YIELD instruction to reduce contention between
-                // hyper-threads
-                std::this_thread::yield();
+                wait();
             }
         }
     }
@@ -41,4 +84,89 @@ struct spinlock {
         lock_.clear(std::memory_order_release);
     }
 };
-} // namespace kangsw
\ No newline at end of file
+
+/**
+ * FIFO spinlock. Each locker draws a ticket, and waits until it is served.
+ * Unlike spinlock, waiters never race on release, thus none of them starves under contention.
+ * FIFO handoff stalls if the next waiter is preempted; keep lockers fewer than cores.
+ */
+class ticket_lock {
+public:
+    void lock() noexcept {
+        auto ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        for (backoff wait; serving_.load(std::memory_order_acquire) != ticket;) { wait(); }
+    }
+
+    bool try_lock() noexcept {
+        auto serving = serving_.load(std::memory_order_acquire);
+        auto ticket = serving;
+        return next_.compare_exchange_strong(ticket, serving + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock() noexcept {
+        serving_.store(serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    alignas(cache_line_size) std::atomic<uint32_t> next_ = 0;
+    alignas(cache_line_size) std::atomic<uint32_t> serving_ = 0;
+};
+
+/**
+ * MCS queue lock. Waiters are linked in FIFO order, and each one spins on its own node,
+ * thus releasing the lock touches only the cache line of the successor.
+ * The node should outlive the critical section; scoped_lock keeps it on stack.
+ */
+class mcs_lock {
+public:
+    struct alignas(cache_line_size) node {
+        std::atomic<node*> next = nullptr;
+        std::atomic<bool> locked = false;
+    };
+
+    class scoped_lock {
+    public:
+        explicit scoped_lock(mcs_lock& lock) noexcept : lock_(lock) { lock_.lock(node_); }
+        ~scoped_lock() noexcept { lock_.unlock(node_); }
+
+        scoped_lock(scoped_lock const&) = delete;
+        scoped_lock& operator=(scoped_lock const&) = delete;
+
+    private:
+        mcs_lock& lock_;
+        node node_;
+    };
+
+    void lock(node& self) noexcept {
+        self.next.store(nullptr, std::memory_order_relaxed);
+        self.locked.store(true, std::memory_order_relaxed);
+
+        auto prev = tail_.exchange(&self, std::memory_order_acq_rel);
+        if (prev == nullptr) { return; }
+
+        prev->next.store(&self, std::memory_order_release);
+        for (backoff wait; self.locked.load(std::memory_order_acquire);) { wait(); }
+    }
+
+    bool try_lock(node& self) noexcept {
+        self.next.store(nullptr, std::memory_order_relaxed);
+        node* expected = nullptr;
+        return tail_.compare_exchange_strong(expected, &self, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock(node& self) noexcept {
+        auto next = self.next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            // no successor yet; release if still tail, otherwise wait for it to link
+            auto expected = &self;
+            if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) { return; }
+            for (backoff wait; (next = self.next.load(std::memory_order_acquire)) == nullptr;) { wait(); }
+        }
+
+        next->locked.store(false, std::memory_order_release);
+    }
+
+private:
+    alignas(cache_line_size) std::atomic<node*> tail_ = nullptr;
+};
+} // namespace kangsw
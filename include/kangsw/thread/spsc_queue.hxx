@@ -0,0 +1,286 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <ki6080@gmail.com> wrote this file. As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.      Seungwoo Kang.
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include "kangsw/thread/thread_utility.hxx"
+
+namespace kangsw::inline threads {
+/**
+ * 단일 생산자/단일 소비자 전용 wait-free 링 버퍼입니다.
+ * circular_queue와 동일하게 capacity + 1개의 슬롯을 사용하며, 한 스레드만 push 계열 함수를,
+ * 다른 한 스레드만 pop 계열 함수와 begin/end/for_each를 호출해야 합니다.
+ *
+ * 각 스레드는 상대편 인덱스의 캐시를 자신의 캐시 라인에 보관하고, 캐시로 판단이 불가능할 때만
+ * 상대편 인덱스를 다시 읽습니다. _n 함수들은 여러 원소를 한 번의 store로 publish/consume합니다.
+ */
+template <typename Ty_>
+class spsc_queue {
+    using chunk_t = std::array<int8_t, sizeof(Ty_)>;
+
+    template <typename It_>
+    static constexpr bool _is_memcpy_compatible
+      = std::is_trivially_copyable_v<Ty_>
+        && std::contiguous_iterator<It_>
+        && std::is_same_v<std::iter_value_t<It_>, Ty_>;
+
+public:
+    using value_type = Ty_;
+
+public:
+    /**
+     * Consumer-side iterator. Valid until the consumer pops the element it refers to.
+     */
+    class iterator {
+    public:
+        using value_type = Ty_;
+        using pointer = Ty_*;
+        using reference = Ty_&;
+        using difference_type = ptrdiff_t;
+        using iterator_category = std::random_access_iterator_tag;
+
+    public:
+        iterator() noexcept = default;
+
+        Ty_& operator*() const { return *_owner->_ptr(_head); }
+        Ty_* operator->() const { return _owner->_ptr(_head); }
+        Ty_& operator[](ptrdiff_t i) const { return *(*this + i); }
+
+        bool operator==(iterator const& op) const noexcept { return _head == op._head; }
+        bool operator<(iterator const& op) const noexcept { return _idx() < op._idx(); }
+        bool operator>(iterator const& op) const noexcept { return op < *this; }
+        bool operator<=(iterator const& op) const noexcept { return !(op < *this); }
+        bool operator>=(iterator const& op) const noexcept { return !(*this < op); }
+
+        auto& operator++() noexcept { return _head = _owner->_jmp(_head, 1), *this; }
+        auto& operator--() noexcept { return _head = _owner->_jmp(_head, -1), *this; }
+
+        auto operator++(int) noexcept {
+            auto c = *this;
+            return ++*this, c;
+        }
+        auto operator--(int) noexcept {
+            auto c = *this;
+            return --*this, c;
+        }
+
+        auto& operator-=(ptrdiff_t i) noexcept { return _head = _owner->_jmp(_head, -i), *this; }
+        auto& operator+=(ptrdiff_t i) noexcept { return _head = _owner->_jmp(_head, i), *this; }
+
+        auto operator-(iterator const& op) const noexcept { return static_cast<ptrdiff_t>(_idx() - op._idx()); }
+
+        friend auto operator+(iterator it, ptrdiff_t i) { return it += i; }
+        friend auto operator+(ptrdiff_t i, iterator it) { return it += i; }
+        friend auto operator-(iterator it, ptrdiff_t i) { return it -= i; }
+
+    private:
+        size_t _idx() const noexcept { return _owner->_distance(_owner->_consumer.tail.load(std::memory_order_relaxed), _head); }
+
+    private:
+        iterator(spsc_queue const* o, size_t h) :
+            _owner(o), _head(h) {}
+        friend class spsc_queue;
+
+        spsc_queue const* _owner = nullptr;
+        size_t _head = 0;
+    };
+
+public:
+    explicit spsc_queue(size_t capacity) :
+        _capacity(capacity + 1), _data(std::make_unique_for_overwrite<chunk_t[]>(_capacity)) {}
+
+    spsc_queue(spsc_queue const&) = delete;
+    spsc_queue& operator=(spsc_queue const&) = delete;
+
+    ~spsc_queue() { pop_n(size()); }
+
+public: // producer side
+    bool try_push(Ty_ const& s) { return _try_emplace(s); }
+    bool try_push(Ty_&& s) { return _try_emplace(std::move(s)); }
+
+    template <typename... Args_>
+    bool try_emplace(Args_&&... args) { return _try_emplace(std::forward<Args_>(args)...); }
+
+    /**
+     * Pushes up to n elements from first, and publishes them at once.
+     * @return number of elements actually pushed.
+     */
+    template <typename It_>
+    size_t try_push_n(It_ first, size_t n) {
+        auto head = _producer.head.load(std::memory_order_relaxed);
+        if (_free(head) < n) { _producer.tail_cache = _consumer.tail.load(std::memory_order_acquire); }
+        n = std::min(n, _free(head));
+        if (n == 0) { return 0; }
+
+        auto n_first = std::min(n, _capacity - head);
+        if constexpr (_is_memcpy_compatible<It_>) {
+            auto src = std::to_address(first);
+            std::memcpy(_ptr(head), src, n_first * sizeof(Ty_));
+            std::memcpy(_ptr(0), src + n_first, (n - n_first) * sizeof(Ty_));
+        }
+        else {
+            auto rest = std::ranges::uninitialized_copy_n(first, n_first, _ptr(head), _ptr(head) + n_first).in;
+            try {
+                std::ranges::uninitialized_copy_n(rest, n - n_first, _ptr(0), _ptr(0) + (n - n_first));
+            } catch (...) {
+                // the second segment cleans up after itself, and the first one is never published
+                std::destroy_n(_ptr(head), n_first);
+                throw;
+            }
+        }
+
+        _producer.head.store(_jmp(head, n), std::memory_order_release);
+        return n;
+    }
+
+public: // consumer side
+    bool try_pop(Ty_& dest) {
+        auto tail = _consumer.tail.load(std::memory_order_relaxed);
+        if (tail == _consumer.head_cache && tail == _refresh_head()) { return false; }
+
+        dest = std::move(*_ptr(tail));
+        _ptr(tail)->~Ty_();
+        _consumer.tail.store(_jmp(tail, 1), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Moves up to n published elements into dest, and consumes them at once.
+     * @return number of elements actually popped.
+     */
+    template <typename OutIt_>
+    size_t try_pop_n(OutIt_ dest, size_t n) {
+        auto tail = _consumer.tail.load(std::memory_order_relaxed);
+        if (_distance(tail, _consumer.head_cache) < n) { _refresh_head(); }
+        n = std::min(n, _distance(tail, _consumer.head_cache));
+        if (n == 0) { return 0; }
+
+        auto n_first = std::min(n, _capacity - tail);
+        if constexpr (_is_memcpy_compatible<OutIt_>) {
+            std::memcpy(std::to_address(dest), _ptr(tail), n_first * sizeof(Ty_));
+            std::memcpy(std::to_address(dest) + n_first, _ptr(0), (n - n_first) * sizeof(Ty_));
+        }
+        else {
+            dest = std::move(_ptr(tail), _ptr(tail) + n_first, dest);
+            std::move(_ptr(0), _ptr(0) + (n - n_first), dest);
+        }
+
+        pop_n(n);
+        return n;
+    }
+
+    /**
+     * Destroies n front elements, which must have been observed via size(), end() or for_each().
+     */
+    void pop_n(size_t n) {
+        auto tail = _consumer.tail.load(std::memory_order_relaxed);
+        assert(n <= _distance(tail, _producer.head.load(std::memory_order_acquire)));
+
+        if constexpr (!std::is_trivially_destructible_v<Ty_>) {
+            for (auto it = tail, i = n; i; --i, it = _jmp(it, 1)) { _ptr(it)->~Ty_(); }
+        }
+        _consumer.tail.store(_jmp(tail, n), std::memory_order_release);
+    }
+
+    void pop() { pop_n(1); }
+
+    Ty_& front() const {
+        assert(!empty());
+        return *_ptr(_consumer.tail.load(std::memory_order_relaxed));
+    }
+
+    auto begin() const noexcept { return iterator(this, _consumer.tail.load(std::memory_order_relaxed)); }
+    auto end() const noexcept { return iterator(this, _refresh_head()); }
+
+    /**
+     * Visits every element published until now, without consuming them.
+     */
+    template <class Fn_>
+    void for_each(Fn_&& fn) const {
+        auto tail = _consumer.tail.load(std::memory_order_relaxed);
+        auto head = _refresh_head();
+
+        if (head >= tail) {
+            std::for_each(_ptr(tail), _ptr(head), fn);
+        }
+        else {
+            std::for_each(_ptr(tail), _ptr(_capacity), fn);
+            std::for_each(_ptr(0), _ptr(head), fn);
+        }
+    }
+
+public: // either side; value may be stale by the time it returns
+    size_t size() const noexcept {
+        auto tail = _consumer.tail.load(std::memory_order_acquire);
+        return _distance(tail, _producer.head.load(std::memory_order_acquire));
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+    size_t capacity() const noexcept { return _capacity - 1; }
+
+private:
+    template <typename... Args_>
+    bool _try_emplace(Args_&&... args) {
+        auto head = _producer.head.load(std::memory_order_relaxed);
+        auto next = _jmp(head, 1);
+        if (next == _producer.tail_cache) {
+            _producer.tail_cache = _consumer.tail.load(std::memory_order_acquire);
+            if (next == _producer.tail_cache) { return false; }
+        }
+
+        new (_ptr(head)) Ty_(std::forward<Args_>(args)...);
+        _producer.head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    size_t _refresh_head() const noexcept {
+        return _consumer.head_cache = _producer.head.load(std::memory_order_acquire);
+    }
+
+    Ty_* _ptr(size_t i) const noexcept {
+        return reinterpret_cast<Ty_*>(const_cast<chunk_t*>(_data.get()) + i);
+    }
+
+    size_t _jmp(size_t at, ptrdiff_t jmp) const noexcept {
+        if (jmp >= 0) { return (at + jmp) % _capacity; }
+        return at += jmp, at + _capacity * ((ptrdiff_t)at < 0);
+    }
+
+    size_t _distance(size_t from, size_t to) const noexcept {
+        return to >= from ? to - from : to + _capacity - from;
+    }
+
+    size_t _free(size_t head) const noexcept {
+        return capacity() - _distance(_producer.tail_cache, head);
+    }
+
+private:
+    // written by producer
+    struct alignas(cache_line_size) {
+        std::atomic_size_t head = 0;
+        size_t tail_cache = 0;
+    } _producer;
+
+    // written by consumer
+    struct alignas(cache_line_size) {
+        std::atomic_size_t tail = 0;
+        mutable size_t head_cache = 0;
+    } _consumer;
+
+    // read-only after construction
+    alignas(cache_line_size) size_t const _capacity;
+    std::unique_ptr<chunk_t[]> const _data;
+};
+} // namespace kangsw::inline threads
@@ -16,6 +16,7 @@
 #include <thread>
 #include <type_traits>
 #include "kangsw/thread/atomic_queue.hxx"
+#include "kangsw/thread/thread_utility.hxx"
 
 namespace kangsw:: inline threads {
 class thread_pool_exception : public std::exception {
@@ -28,6 +29,9 @@ public:
 class future_proxy_base {
 public:
     virtual ~future_proxy_base() = default;
+
+    // Delivers exception of the task itself, or of the task which this proxy was chained to.
+    virtual void _set_exception(class thread_pool* pool, std::exception_ptr e) = 0;
 };
 
 template <typename Ty_>
@@ -56,7 +60,7 @@ public:
         return future_;
     }
 
-    future_proxy() = default;
+    future_proxy() { future_ = promise_.get_future().share(); }
     future_proxy(const future_proxy& other) = default;
     future_proxy(future_proxy&& other) noexcept = default;
     future_proxy& operator=(const future_proxy& other) = default;
@@ -70,6 +74,24 @@ public:
     std::shared_ptr<future_proxy<std::invoke_result_t<Fn_, Args_...>>>
     then(Fn_&&, Args_&&... args);
 
+    void _set_exception(class thread_pool* pool, std::exception_ptr e) override {
+        std::lock_guard lock(then_lock_);
+        if (deferred_proxy_ && then_fn_) {
+            // continuation is skipped, and the exception goes down to the end of the chain.
+            deferred_proxy_->_set_exception(pool, std::move(e));
+        }
+        else {
+            promise_.set_exception(std::move(e));
+        }
+    }
+
+    // Delivers result to continuation or to the promise. Never throws into the worker.
+    void _set_value(class thread_pool* pool, Ty_&& value) noexcept;
+
+private:
+    template <typename Proxy_>
+    std::shared_ptr<Proxy_> _try_propagate_ready_exception();
+
 private:
     class thread_pool* owner_ = nullptr;
     std::shared_future<Ty_> future_;
@@ -83,6 +105,9 @@ private:
 
 template <>
 class future_proxy<void> : public future_proxy_base {
+public:
+    // Nothing can observe result of void task, thus hands it over to the pool.
+    inline void _set_exception(class thread_pool* pool, std::exception_ptr e) override;
 };
 
 class thread_pool {
@@ -112,12 +137,13 @@ public:
     size_t num_workers() const { return num_workers_cached_; }
     size_t num_pending_task() const { return tasks_.size(); }
     size_t task_queue_capacity() const { return tasks_.capacity(); }
-    size_t num_available_workers() const { return num_workers_cached_ - num_working_workers_; }
-    clock::duration average_interval() const { return clock::duration(average_interval_.load()); }
-    clock::duration average_wait() const { return clock::duration(true_average_wait_.load()); }
-    clock::duration _internal_average_wait() const { return clock::duration(refreshed_average_wait_.load()); }
+    size_t num_available_workers() const { return _aggregate_stats(), num_workers_cached_ - summary_.num_working.load(); }
+    clock::duration average_interval() const { return _aggregate_stats(), clock::duration(summary_.average_interval.load()); }
+    clock::duration average_wait() const { return _aggregate_stats(), clock::duration(summary_.true_average_wait.load()); }
+    clock::duration _internal_average_wait() const { return _aggregate_stats(), clock::duration(summary_.refreshed_average_wait.load()); }
     size_t num_max_workers() const { return num_max_workers_; }
     void num_max_workers(size_t value);
+    size_t num_unhandled_exceptions() const { return num_unhandled_exceptions_; }
 
     template <typename Fn_, typename... Args_>
     decltype(auto) add_task(Fn_&& f, Args_... args);
@@ -126,57 +152,71 @@ public:
     template <typename Fn_, typename... Args_> void _package_task(
       thread_pool::task_function_type& event, std::shared_ptr<future_proxy_base> retval, Fn_&& f, Args_... args);
     void _enqueue_task(task_t&& task);
+    void _on_unhandled_exception(std::exception_ptr e) noexcept;
 
 private:
     bool _try_add_worker();
     void _pop_workers(size_t count);
     void _check_reserve_worker(size_t threshold);
+    void _aggregate_stats() const;
 
 public:
     std::chrono::milliseconds launch_timeout_ms{1000};
     std::chrono::microseconds max_stall_interval_time{1000000};
     std::chrono::microseconds max_task_interval_time{1000000};
     std::chrono::microseconds max_task_wait_time{1000000};
+    std::chrono::microseconds reserve_check_interval{1000};
     std::atomic_size_t average_weight = 10;
 
+    /**
+     * Receives exceptions which no future can deliver, e.g. thrown from void task.
+     * Invoked on worker thread. Set this before adding any task.
+     */
+    std::function<void(std::exception_ptr)> unhandled_exception_handler;
+
 private:
-    struct worker_t {
-        struct atomic_bool_wrap_t {
-            std::atomic_bool value;
+    // Statistics written only by its owning worker, on every task.
+    // Each one occupies its own cache line, and summed up lazily on read.
+    struct alignas(cache_line_size) worker_stat_t {
+        std::atomic_bool busy = false;
+        std::atomic<clock::time_point> latest_active = clock::time_point{};
+        std::atomic<clock::time_point> latest_event = clock::time_point{};
+        std::atomic<int64_t> average_interval = 0;
+        std::atomic<int64_t> refreshed_average_wait = 0;
+        std::atomic<int64_t> true_average_wait = 0;
+    };
 
-            atomic_bool_wrap_t() = default;
-            atomic_bool_wrap_t(const atomic_bool_wrap_t& other) = delete;
-            atomic_bool_wrap_t(atomic_bool_wrap_t&& other) noexcept {
-                value = other.value.load();
-            }
-            atomic_bool_wrap_t& operator=(const atomic_bool_wrap_t& other) = delete;
-            atomic_bool_wrap_t& operator=(atomic_bool_wrap_t&& other) noexcept {
-                value = other.value.load();
-                return *this;
-            }
-        };
+    struct worker_t {
+        worker_stat_t stat;
         std::thread thread;
-        atomic_bool_wrap_t disposer;
+        std::atomic_bool disposer = false;
+    };
+
+    struct stat_summary_t {
+        std::atomic_size_t num_working = 0;
+        std::atomic<clock::time_point> latest_active = clock::now();
+        std::atomic<int64_t> average_interval = 0;
+        std::atomic<int64_t> refreshed_average_wait = 0;
+        std::atomic<int64_t> true_average_wait = 0;
     };
 
 private:
     atomic_queue<task_t> tasks_;
-    std::vector<worker_t> workers_;
+    std::vector<std::unique_ptr<worker_t>> workers_;
     mutable std::shared_mutex worker_lock_;
 
     std::condition_variable event_wait_;
     mutable std::mutex event_lock_;
 
     std::atomic_size_t num_workers_cached_;
-    std::atomic_size_t num_working_workers_;
     std::atomic_size_t num_max_workers_;
+    std::atomic_size_t num_unhandled_exceptions_ = 0;
 
-    std::atomic<clock::time_point> latest_active_ = clock::now();
     std::atomic<clock::time_point> latest_event_ = clock::now();
     std::atomic<clock::time_point> latest_worker_change_ = clock::now();
-    std::atomic<int64_t> average_interval_;
-    std::atomic<int64_t> refreshed_average_wait_;
-    std::atomic<int64_t> true_average_wait_;
+    std::atomic<clock::time_point> next_reserve_check_ = clock::time_point{};
+
+    mutable stat_summary_t summary_;
 };
 
 template <typename Fn_, typename... Args_>
@@ -187,61 +227,49 @@ void thread_pool::_package_task(task_function_type& event, std::shared_ptr<futur
     using promise_ptr = std::shared_ptr<std::promise<callable_return_type>>;
     auto retval = std::static_pointer_cast<proxy_type>(result);
 
+    // Exceptions are caught on every task, which costs nothing until something is thrown.
+    // Then it is stored in the proxy to be rethrown from get(), or handed over to the pool.
     if constexpr (returns_void::value) {
-        event = [fn_ = std::forward<Fn_>(f),
+        event = [this,
+                 fn_ = std::forward<Fn_>(f),
                  arg_tuple_ = std::make_tuple(std::forward<Args_>(args)...)]() mutable {
-            // Storing exception features are only available on release build,
-            //to improve debug
-            if constexpr (returns_void::value) {
+            try {
                 std::apply(fn_, std::move(arg_tuple_));
+            } catch (...) {
+                _on_unhandled_exception(std::current_exception());
             }
         };
     }
     else {
         retval->owner_ = this;
-        retval->future_ = retval->promise_.get_future().share();
         auto function = std::bind(std::forward<Fn_>(f), std::forward<Args_>(args)...);
         event = [this, proxy = retval,
                  fn_ = std::move(function)]() mutable {
-            auto& promise_ = proxy->promise_;
-
-#if KANGSW_THREAD_POOL_CATCH_PROMISE_EXCEPTIONS
             try {
-#endif
-                auto exec_result = fn_();
-
-                if (std::lock_guard lock(proxy->then_lock_);
-                    proxy->deferred_proxy_ && proxy->then_fn_) {
-                    proxy->then_fn_(std::move(exec_result));
-                }
-                else {
-                    promise_.set_value(std::move(exec_result));
-                }
-#if KANGSW_THREAD_POOL_CATCH_PROMISE_EXCEPTIONS
-            } catch (std::exception&) {
-                do {
-                    try {
-                        // if future was already retrieved, below statement will throw.
-                        // then do nothing, to mandate error handling to caller
-                        auto v = promise_.get_future();
-                    } catch (std::exception&) {
-                        break;
-                    }
-
-                    // else, given promise was expired before the future was retrieved.
-                    // then this block simply rethrow the exception, which occurs program termination.
-                    throw;
-                } while (false);
-
-                // if above statement did not thrown, it means the future was correctly
-                //retrieved when it was launched.
-                promise_.set_exception(std::current_exception());
+                // result is handed over directly, thus reference results need no holder.
+                proxy->_set_value(this, fn_());
+            } catch (...) {
+                proxy->_set_exception(this, std::current_exception());
             }
-#endif
         };
     }
 }
 
+inline void thread_pool::_on_unhandled_exception(std::exception_ptr e) noexcept {
+    num_unhandled_exceptions_.fetch_add(1, std::memory_order_relaxed);
+    if (unhandled_exception_handler) {
+        try {
+            unhandled_exception_handler(std::move(e));
+        } catch (...) {
+            // handler itself must not take the worker down.
+        }
+    }
+}
+
+inline void future_proxy<void>::_set_exception(thread_pool* pool, std::exception_ptr e) {
+    pool->_on_unhandled_exception(std::move(e));
+}
+
 inline void thread_pool::_enqueue_task(task_t&& task) {
     if (num_pending_task() == 0) {
         latest_event_ = clock::now();
@@ -282,6 +310,7 @@ inline thread_pool::thread_pool(size_t task_queue_cap_, size_t num_workers, size
 }
 
 inline thread_pool::~thread_pool() {
+    std::unique_lock lock(worker_lock_);
     _pop_workers(workers_.size());
 }
 
@@ -292,7 +321,7 @@ inline void thread_pool::resize_worker_pool(size_t new_size, bool is_trial) {
     }
 
     std::unique_lock lock(worker_lock_, std::defer_lock);
-    if (!is_trial || lock.try_lock()) {
+    if (is_trial ? lock.try_lock() : (lock.lock(), true)) {
         if (new_size > workers_.size()) {
             while (new_size != workers_.size()) {
                 _try_add_worker();
@@ -311,7 +340,7 @@ inline void thread_pool::num_max_workers(size_t value) {
         throw std::invalid_argument("0 is not allowed");
     }
 
-    std::shared_lock lock{worker_lock_};
+    std::unique_lock lock{worker_lock_};
     num_max_workers_ = value;
 
     if (value < workers_.size()) {
@@ -325,8 +354,10 @@ inline bool thread_pool::_try_add_worker() {
         return false;
     }
 
-    auto worker = [this, index = workers_.size()]() {
+    auto& wd = *workers_.emplace_back(std::make_unique<worker_t>());
+    auto worker = [this, &wd]() {
         task_t task;
+        auto& stat = wd.stat;
 
         auto calc_diff = [this](clock::time_point issued, size_t average, size_t weight) {
             auto wait_time = (clock::now() - issued).count();
@@ -336,28 +367,31 @@ inline bool thread_pool::_try_add_worker() {
             return diff;
         };
 
-        while (workers_[index].disposer.value == false) {
+        while (wd.disposer == false) {
             if (tasks_.try_pop(task)) {
                 auto weight = std::max<size_t>(1, average_weight.load(RELAXED));
 
-                auto issued = latest_event_.load(RELAXED);
-                auto average = average_interval_.load(RELAXED);
-                average_interval_.fetch_add(calc_diff(issued, average, weight), RELAXED);
+                // only this worker writes to its own stat, thus plain load-store is enough.
+                auto issued = std::max(stat.latest_event.load(RELAXED), latest_event_.load(RELAXED));
+                auto average = stat.average_interval.load(RELAXED);
+                stat.average_interval.store(average + calc_diff(issued, average, weight), RELAXED);
 
-                issued = std::max(task.issued, latest_worker_change_.load());
-                average = refreshed_average_wait_.load(RELAXED);
-                refreshed_average_wait_.fetch_add(calc_diff(issued, average, weight), RELAXED);
+                issued = std::max(task.issued, latest_worker_change_.load(RELAXED));
+                average = stat.refreshed_average_wait.load(RELAXED);
+                stat.refreshed_average_wait.store(average + calc_diff(issued, average, weight), RELAXED);
 
-                true_average_wait_.fetch_add(calc_diff(task.issued, true_average_wait_.load(RELAXED), weight), RELAXED);
+                average = stat.true_average_wait.load(RELAXED);
+                stat.true_average_wait.store(average + calc_diff(task.issued, average, weight), RELAXED);
 
                 _check_reserve_worker(2);
-                latest_active_ = clock::now();
-                latest_event_ = clock::now();
-                num_working_workers_.fetch_add(1);
+                auto now = clock::now();
+                stat.latest_active.store(now, RELAXED);
+                stat.latest_event.store(now, RELAXED);
+                stat.busy.store(true, RELAXED);
 
                 task.event();
 
-                num_working_workers_.fetch_sub(1);
+                stat.busy.store(false, RELAXED);
             }
             else {
                 std::unique_lock<std::mutex> lock(event_lock_);
@@ -366,8 +400,6 @@ inline bool thread_pool::_try_add_worker() {
         }
     };
 
-    auto& wd = workers_.emplace_back();
-    wd.disposer.value = false;
     wd.thread = std::thread(std::move(worker));
 
     num_workers_cached_ = workers_.size();
@@ -379,11 +411,11 @@ inline void thread_pool::_pop_workers(size_t count) {
     auto const end = workers_.end();
 
     for (auto it = begin; it != end; ++it) {
-        it->disposer.value.store(true);
+        (*it)->disposer.store(true);
     }
     event_wait_.notify_all();
     for (auto it = begin; it != end; ++it) {
-        it->thread.join();
+        (*it)->thread.join();
     }
 
     workers_.erase(begin, end);
@@ -391,15 +423,59 @@ inline void thread_pool::_pop_workers(size_t count) {
 }
 
 inline void thread_pool::_check_reserve_worker(size_t threshold) {
+    // aggregating statistics touches every worker's cache line, thus throttle it.
+    auto now = clock::now();
+    auto next_check = next_reserve_check_.load(std::memory_order_relaxed);
+    if (now < next_check
+        || !next_reserve_check_.compare_exchange_strong(next_check, now + reserve_check_interval)) {
+        return;
+    }
+
     if ( // reserve workers if required.
       num_available_workers() <= threshold
-      && (clock::now() - latest_active_.load() > max_stall_interval_time
-          || average_interval() > max_task_interval_time
-          || _internal_average_wait() > max_task_wait_time)) {
+      && (now - summary_.latest_active.load() > max_stall_interval_time
+          || clock::duration(summary_.average_interval.load()) > max_task_interval_time
+          || clock::duration(summary_.refreshed_average_wait.load()) > max_task_wait_time)) {
         resize_worker_pool((num_workers() & ~1) + 2, true);
     }
 }
 
+inline void thread_pool::_aggregate_stats() const {
+    // Never blocks; worker threads may call this while the pool is being resized.
+    // If the lock is not available, previous summary is kept.
+    std::shared_lock lock(worker_lock_, std::try_to_lock);
+    if (!lock) { return; }
+
+    static auto constexpr RELAXED = std::memory_order_relaxed;
+    size_t num_working = 0, num_sampled = 0;
+    auto latest_active = summary_.latest_active.load(RELAXED);
+    int64_t refreshed_wait_sum = 0, true_wait_sum = 0;
+    double rate_sum = 0;
+
+    for (auto& worker : workers_) {
+        auto& stat = worker->stat;
+        num_working += stat.busy.load(RELAXED);
+
+        auto active = stat.latest_active.load(RELAXED);
+        if (active == clock::time_point{}) { continue; }
+
+        // every worker contributes its own rate, thus pool-wide interval is a harmonic sum of them.
+        latest_active = std::max(latest_active, active);
+        if (auto interval = stat.average_interval.load(RELAXED); interval > 0) { rate_sum += 1.0 / interval; }
+        refreshed_wait_sum += stat.refreshed_average_wait.load(RELAXED);
+        true_wait_sum += stat.true_average_wait.load(RELAXED);
+        ++num_sampled;
+    }
+
+    summary_.num_working.store(num_working, RELAXED);
+    summary_.latest_active.store(latest_active, RELAXED);
+    summary_.average_interval.store(rate_sum > 0 ? int64_t(1.0 / rate_sum) : 0, RELAXED);
+    if (num_sampled) {
+        summary_.refreshed_average_wait.store(refreshed_wait_sum / int64_t(num_sampled), RELAXED);
+        summary_.true_average_wait.store(true_wait_sum / int64_t(num_sampled), RELAXED);
+    }
+}
+
 template <typename Ty_> template <typename Fn_, typename... Args_>
 std::shared_ptr<future_proxy<std::invoke_result_t<Fn_, Ty_, Args_...>>>
 future_proxy<Ty_>::then(Fn_&& f, Args_&&... args) {
@@ -410,15 +486,19 @@ future_proxy<Ty_>::then(Fn_&& f, Args_&&... args) {
         throw thread_pool_exception("invalid multiple then() request");
     }
 
+    using result_type = std::invoke_result_t<Fn_, Ty_, Args_...>;
+    using proxy_type = future_proxy<result_type>;
+
     if (future_.valid()
         && future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
         // if async execution was already done before call then(),
         //queue bound task immediately.
+        if (auto failed = _try_propagate_ready_exception<proxy_type>()) { return failed; }
         return owner_->add_task(std::forward<Fn_>(f), future_.get(), std::forward<Args_>(args)...);
     }
 
-    using proxy_type = future_proxy<std::invoke_result_t<Fn_, Ty_, Args_...>>;
     auto deferred = std::make_shared<proxy_type>();
+    if constexpr (!std::is_void_v<result_type>) { deferred->owner_ = owner_; }
     deferred_proxy_ = deferred;
 
     auto bound = std::bind(std::forward<Fn_>(f), std::placeholders::_1, std::forward<Args_>(args)...);
@@ -440,15 +520,19 @@ future_proxy<Ty_>::then(Fn_&& f, Args_&&... args) {
         throw thread_pool_exception("invalid multiple then() request");
     }
 
+    using result_type = std::invoke_result_t<Fn_, Args_...>;
+    using proxy_type = future_proxy<result_type>;
+
     if (future_.valid()
         && future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
         // if async execution was already done before call then(),
         //queue bound task immediately.
+        if (auto failed = _try_propagate_ready_exception<proxy_type>()) { return failed; }
         return owner_->add_task(std::forward<Fn_>(f), std::forward<Args_>(args)...);
     }
 
-    using proxy_type = future_proxy<std::invoke_result_t<Fn_, Args_...>>;
     auto deferred = std::make_shared<proxy_type>();
+    if constexpr (!std::is_void_v<result_type>) { deferred->owner_ = owner_; }
     deferred_proxy_ = deferred;
 
     auto bound = std::bind(std::forward<Fn_>(f), std::forward<Args_>(args)...);
@@ -463,6 +547,38 @@ future_proxy<Ty_>::then(Fn_&& f, Args_&&... args) {
     return deferred;
 }
 
+template <typename Ty_>
+void future_proxy<Ty_>::_set_value(thread_pool* pool, Ty_&& value) noexcept {
+    std::lock_guard lock(then_lock_);
+    bool chained = deferred_proxy_ && then_fn_;
+    try {
+        if (chained) { then_fn_(std::forward<Ty_>(value)); }
+        else { promise_.set_value(std::forward<Ty_>(value)); }
+    } catch (...) {
+        // continuation couldn't be queued, e.g. the queue stayed full; the chain receives the error instead.
+        try {
+            if (chained) { deferred_proxy_->_set_exception(pool, std::current_exception()); }
+            else { pool->_on_unhandled_exception(std::current_exception()); }
+        } catch (...) {
+            pool->_on_unhandled_exception(std::current_exception());
+        }
+    }
+}
+
+template <typename Ty_> template <typename Proxy_>
+std::shared_ptr<Proxy_> future_proxy<Ty_>::_try_propagate_ready_exception() {
+    try {
+        future_.get();
+        return nullptr;
+    } catch (...) {
+        // then() on already failed task; the continuation never runs.
+        auto failed = std::make_shared<Proxy_>();
+        if constexpr (!std::is_same_v<Proxy_, future_proxy<void>>) { failed->owner_ = owner_; }
+        failed->_set_exception(owner_, std::current_exception());
+        return failed;
+    }
+}
+
 // timer thread pool
 class timer_thread_pool : public thread_pool {
 public:
@@ -8,9 +8,18 @@
  */
 #pragma once
 #include <atomic>
+#include <chrono>
 #include <shared_mutex>
+#include <thread>
 
 namespace kangsw:: inline threads {
+/**
+ * false sharing을 피하기 위한 정렬 단위.
+ * std::hardware_destructive_interference_size는 ABI 경고가 발생하므로, 대부분의 x86/ARM 코어에
+ * 맞는 고정값을 사용합니다.
+ */
+constexpr size_t cache_line_size = 64;
+
 /**
  * 프로세스가 스코프 바깥으로 나가는 것을 방지.
  * 멀티스레드 환경에서, 클래스 멤버 가장 아래쪽에 배치하여 소멸 시점을 제어할 수 있습니다.
@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <utility>
 #include <kangsw/algorithm/hungarian.hxx>
 #include "catch.hpp"
 
@@ -18,5 +24,284 @@ TEST_CASE("Hungarian", "[Algorithms]") {
                 13, 13, 11, 12});
 
     assignment = kangsw::algorithm::hungarian(std::move(arr));
-    REQUIRE(std::ranges::equal(assignment, std::initializer_list{0, 3, 1, 2}));
+    REQUIRE(std::ranges::equal(assignment, std::initializer_list{1, 3, 0, 2}));
+}
+
+TEMPLATE_TEST_CASE("Hungarian optimality", "[Algorithms]", int, float, double) {
+    std::mt19937 rand{0x9496};
+    std::uniform_int_distribution<int> dist{0, 100};
+
+    for (size_t len = 1; len <= 7; ++len) {
+        for (int iter = 0; iter < 20; ++iter) {
+            kangsw::ndarray<TestType, 2> arr{len, len};
+            for (auto& v : arr) { v = TestType(dist(rand)) / TestType(4); }
+            auto costs = arr;
+
+            // brute force every permutation
+            std::vector<size_t> perm(len);
+            std::iota(perm.begin(), perm.end(), 0);
+            auto best = std::numeric_limits<TestType>::max();
+            do {
+                TestType sum = 0;
+                for (size_t r = 0; r < len; ++r) { sum += costs(r, perm[r]); }
+                best = std::min(best, sum);
+            } while (std::next_permutation(perm.begin(), perm.end()));
+
+            auto assignment = kangsw::algorithm::hungarian(std::move(arr));
+            TestType sum = 0;
+            for (size_t r = 0; r < len; ++r) { sum += costs(r, assignment[r]); }
+
+            auto sorted = assignment;
+            std::ranges::sort(sorted);
+            REQUIRE(std::ranges::equal(sorted, kangsw::counter(len)));
+            REQUIRE(sum == best);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE("Hungarian scan kernel", "[Algorithms]", float, double) {
+    // overload picks vectorized kernel if the build has one; explicit template arguments pick scalar one
+    std::mt19937 rand{0x5ca7};
+    std::uniform_int_distribution<int> dist{0, 100};
+    auto const inf = std::numeric_limits<TestType>::max();
+
+    for (size_t m = 0; m <= 37; ++m) {
+        std::vector<TestType> costs(m), v(m), minv(m);
+        std::vector<char> used(m);
+        std::vector<size_t> way(m, 0);
+        for (size_t col = 0; col < m; ++col) {
+            costs[col] = TestType(dist(rand)), v[col] = TestType(dist(rand) / 4);
+            minv[col] = dist(rand) < 30 ? inf : TestType(dist(rand) / 2);
+            used[col] = dist(rand) < 25;
+        }
+
+        auto scalar_minv = minv;
+        auto scalar_way = way;
+        auto scalar = kangsw::algorithm::_hungarian_scan<TestType, TestType>(
+          costs.data(), TestType(3), v.data(), scalar_minv.data(), used.data(), scalar_way.data(), 7, m);
+        auto result = kangsw::algorithm::_hungarian_scan(
+          costs.data(), TestType(3), v.data(), minv.data(), used.data(), way.data(), 7, m);
+
+        CHECK(result == scalar);
+        CHECK(minv == scalar_minv);
+        CHECK(way == scalar_way);
+    }
+}
+
+TEMPLATE_TEST_CASE("Hungarian rectangular", "[Algorithms]", int, float, double) {
+    using kangsw::algorithm::hungarian_unassigned;
+    std::mt19937 rand{0x9496};
+    std::uniform_int_distribution<int> dist{-50, 100};
+
+    for (size_t rows = 1; rows <= 6; ++rows) {
+        for (size_t cols = 1; cols <= 6; ++cols) {
+            kangsw::ndarray<TestType, 2> arr{rows, cols};
+            for (auto& v : arr) { v = TestType(dist(rand)) / TestType(4); }
+            auto costs = arr;
+
+            // brute force on zero-padded square matrix
+            auto const len = std::max(rows, cols);
+            std::vector<size_t> perm(len);
+            std::iota(perm.begin(), perm.end(), 0);
+            auto best = std::numeric_limits<TestType>::max();
+            do {
+                TestType sum = 0;
+                for (size_t r = 0; r < rows; ++r) { sum += perm[r] < cols ? costs(r, perm[r]) : 0; }
+                best = std::min(best, sum);
+            } while (std::next_permutation(perm.begin(), perm.end()));
+
+            auto assignment = kangsw::algorithm::hungarian(std::move(arr));
+            REQUIRE(assignment.size() == rows);
+            REQUIRE(size_t(std::ranges::count(assignment, hungarian_unassigned)) == rows - std::min(rows, cols));
+
+            TestType sum = 0;
+            std::vector<char> used(cols);
+            for (size_t r = 0; r < rows; ++r) {
+                if (assignment[r] == hungarian_unassigned) { continue; }
+                REQUIRE(!used[assignment[r]]);
+                used[assignment[r]] = true;
+                sum += costs(r, assignment[r]);
+            }
+            REQUIRE(sum == best);
+        }
+    }
+
+    std::array a = {1, 5, 9};
+    std::array b = {8, 2};
+    auto assignment = kangsw::algorithm::hungarian(a, b, [](int x, int y) { return std::abs(x - y); });
+    REQUIRE(assignment == kangsw::algorithm::hungarian_result_t{1, hungarian_unassigned, 0});
+}
+
+TEMPLATE_TEST_CASE("Hungarian sparse", "[Algorithms]", int, double) {
+    using kangsw::algorithm::hungarian_unassigned;
+    std::mt19937 rand{0x9496};
+    std::uniform_int_distribution<int> dist{-20, 100};
+    std::bernoulli_distribution has_edge{0.4};
+
+    for (size_t rows = 1; rows <= 6; ++rows) {
+        for (size_t cols = 1; cols <= 6; ++cols) {
+            for (int iter = 0; iter < 5; ++iter) {
+                kangsw::algorithm::hungarian_sparse<TestType> sp{.num_cols = cols};
+                std::vector<std::optional<TestType>> dense(rows * cols);
+                for (size_t r = 0; r < rows; ++r) {
+                    sp.push_row();
+                    for (size_t c = 0; c < cols; ++c) {
+                        if (!has_edge(rand)) { continue; }
+                        auto cost = TestType(dist(rand)) / TestType(4);
+                        sp.push(c, cost), dense[r * cols + c] = cost;
+                    }
+                }
+
+                // brute force: maximum number of pairs first, then minimum cost
+                std::pair<size_t, TestType> best{0, 0};
+                std::vector<char> used(cols);
+                auto search = [&](auto&& self, size_t r, size_t num, TestType sum) -> void {
+                    if (r == rows) {
+                        if (num > best.first || (num == best.first && sum < best.second)) { best = {num, sum}; }
+                        return;
+                    }
+                    self(self, r + 1, num, sum);
+                    for (size_t c = 0; c < cols; ++c) {
+                        if (used[c] || !dense[r * cols + c]) { continue; }
+                        used[c] = true;
+                        self(self, r + 1, num + 1, sum + *dense[r * cols + c]);
+                        used[c] = false;
+                    }
+                };
+                search(search, 0, 0, 0);
+
+                auto assignment = kangsw::algorithm::hungarian(sp);
+                REQUIRE(assignment.size() == rows);
+
+                std::pair<size_t, TestType> found{0, 0};
+                std::ranges::fill(used, false);
+                for (size_t r = 0; r < rows; ++r) {
+                    auto c = assignment[r];
+                    if (c == hungarian_unassigned) { continue; }
+                    REQUIRE(c < cols);
+                    REQUIRE(!used[c]);
+                    REQUIRE(dense[r * cols + c]);
+                    used[c] = true;
+                    found.first++, found.second += *dense[r * cols + c];
+                }
+                REQUIRE(found == best);
+            }
+        }
+    }
+
+    kangsw::algorithm::hungarian_sparse<TestType> malformed{.num_cols = 2};
+    malformed.push_row();
+    malformed.push(2, 1);
+    REQUIRE_THROWS_AS(kangsw::algorithm::hungarian(malformed), std::invalid_argument);
+
+    malformed.cols.back() = 1;
+    malformed.costs.push_back(0);
+    REQUIRE_THROWS_AS(kangsw::algorithm::hungarian(malformed), std::invalid_argument);
+}
+
+TEST_CASE("Hungarian solver reuse", "[Algorithms]") {
+    using namespace kangsw::algorithm;
+    std::mt19937 rand{0x9496};
+    std::uniform_int_distribution<int> dist{0, 100};
+
+    // costs are a window of larger caller storage
+    constexpr size_t stride = 16;
+    std::vector<int> storage(stride * stride);
+    hungarian_solver<int> solver;
+
+    for (int iter = 0; iter < 50; ++iter) {
+        size_t rows = 1 + rand() % 12, cols = 1 + rand() % 12;
+        std::ranges::generate(storage, [&] { return dist(rand); });
+
+        kangsw::ndarray<int, 2> arr{rows, cols};
+        for (size_t r = 0; r < rows; ++r) {
+            for (size_t c = 0; c < cols; ++c) { arr(r, c) = storage[(r + 2) * stride + c + 3]; }
+        }
+
+        hungarian_cost_view<int> view{&storage[2 * stride + 3], rows, cols, stride};
+        auto expected = hungarian(kangsw::ndarray{arr});
+        REQUIRE(solver(view) == expected);
+        REQUIRE(solver(arr) == expected);
+        REQUIRE(solver(std::as_const(arr).slice(kangsw::ndall, kangsw::ndall)) == expected);
+
+        // column-strided view is packed internally
+        auto transposed = solver(view.transpose());
+        REQUIRE(transposed == hungarian(view.transpose()));
+        int cost = 0, transposed_cost = 0;
+        for (size_t r = 0; r < rows; ++r) { cost += expected[r] != hungarian_unassigned ? arr(r, expected[r]) : 0; }
+        for (size_t c = 0; c < cols; ++c) { transposed_cost += transposed[c] != hungarian_unassigned ? arr(transposed[c], c) : 0; }
+        REQUIRE(cost == transposed_cost);
+    }
+}
+
+TEMPLATE_TEST_CASE("Hungarian auction", "[Algorithms]", int, double) {
+    using namespace kangsw::algorithm;
+    std::mt19937 rand{0x9496};
+    std::uniform_int_distribution<int> dist{-100, 1000};
+
+    hungarian_solver<TestType> exact, auction;
+    auction.options.method = hungarian_method::auction;
+
+    for (int iter = 0; iter < 100; ++iter) {
+        size_t rows = 1 + rand() % 40, cols = 1 + rand() % 40;
+        kangsw::ndarray<TestType, 2> arr{rows, cols};
+        for (auto& v : arr) { v = TestType(dist(rand)) / TestType(4); }
+
+        auto cost_of = [&](hungarian_result_t const& assignment) {
+            TestType sum = 0;
+            REQUIRE(size_t(std::ranges::count(assignment, hungarian_unassigned)) == rows - std::min(rows, cols));
+            for (size_t r = 0; r < rows; ++r) { sum += assignment[r] != hungarian_unassigned ? arr(r, assignment[r]) : 0; }
+            return sum;
+        };
+
+        auto expected = cost_of(exact(arr));
+        auto found = cost_of(auction(arr));
+        if constexpr (std::is_integral_v<TestType>) { REQUIRE(found == expected); }
+        else { REQUIRE(found == Approx(expected).margin(1e-6 * 1100 / 4)); }
+    }
+}
+
+TEST_CASE("Hungarian batch", "[Algorithms]") {
+    using namespace kangsw::algorithm;
+    std::mt19937 rand{0x9496};
+    std::uniform_real_distribution<float> dist{0, 100};
+
+    std::vector<kangsw::ndarray<float, 2>> problems;
+    hungarian_result_t expected;
+    for (int iter = 0; iter < 500; ++iter) {
+        auto& arr = problems.emplace_back(1 + rand() % 10, 1 + rand() % 10);
+        for (auto& v : arr) { v = dist(rand); }
+
+        auto result = hungarian(kangsw::ndarray{arr});
+        expected.insert(expected.end(), result.begin(), result.end());
+    }
+
+    hungarian_result_t out(expected.size());
+    REQUIRE(hungarian_batch(std::execution::par, problems, out) == expected.size());
+    REQUIRE(out == expected);
+
+    std::ranges::fill(out, 0);
+    REQUIRE(hungarian_batch(std::execution::seq, problems, out, {}, 1) == expected.size());
+    REQUIRE(out == expected);
+
+    out.pop_back();
+    REQUIRE_THROWS(hungarian_batch(std::execution::par, problems, out));
+}
+
+TEST_CASE("Hungarian large", "[Algorithms]") {
+    std::mt19937 rand{0x9496};
+    std::uniform_real_distribution<float> dist{0, 1000};
+
+    constexpr size_t len = 500;
+    kangsw::ndarray<float, 2> arr{len, len};
+    for (auto& v : arr) { v = dist(rand); }
+
+    // planted optimum: zero cost on a random permutation
+    std::vector<size_t> planted(len);
+    std::iota(planted.begin(), planted.end(), 0);
+    std::shuffle(planted.begin(), planted.end(), rand);
+    for (size_t r = 0; r < len; ++r) { arr(r, planted[r]) = 0; }
+
+    auto assignment = kangsw::algorithm::hungarian(std::move(arr));
+    REQUIRE(assignment == planted);
 }
@@ -1,9 +1,18 @@
 #define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <cstring>
+#include <execution>
+#include <numeric>
 #include <ranges>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "catch.hpp"
 #include "kangsw/container/circular_queue.hxx"
 #include "kangsw/container/ndarray.hxx"
+#include "kangsw/container/ndarray_expr.hxx"
+#include "kangsw/container/ndarray_file.hxx"
+#include "kangsw/container/soa_vector.hxx"
 #include "kangsw/helpers/counter.hxx"
 
 namespace kangsw::container_test {
@@ -17,7 +26,7 @@ TEST_CASE("ndarray") {
     REQUIRE_THROWS(ndr.at(24, 34, 3));
 
     auto dim = ndr.dims();
-    for (auto& idx : counter(dim[0], dim[1], dim[2])) {
+    for (auto const& idx : counter(dim[0], dim[1], dim[2])) {
         ndr[idx] += 1;
     }
 
@@ -45,13 +54,355 @@ TEST_CASE("ndarray") {
 
     auto ff = ndr;
     for (auto& elem : ff) { elem = 0x9496; }
-    for (auto& idx : counter(dim)) { ndr[idx] = 0x9496; }
+    for (auto const& idx : counter(dim)) { ndr[idx] = 0x9496; }
 
     for (auto [target, gt] : zip(ndr, ff)) {
         CHECK(target == gt);
     }
 }
 
+TEST_CASE("ndarray_view") {
+    ndarray<int, 3> arr(4, 5, 6);
+    std::iota(arr.begin(), arr.end(), 0);
+    auto value = [&](size_t i, size_t j, size_t k) { return int(i * 30 + j * 6 + k); };
+
+    auto sub = arr.slice(ndslice{1, 4, 2}, ndall, 3);
+    REQUIRE(sub.dims() == std::array<size_t, 2>{2, 5});
+    REQUIRE(sub.is_contiguous() == false);
+    for (auto [i, j] : counter(2, 5)) { CHECK(sub(i, j) == value(1 + i * 2, j, 3)); }
+
+    // views share memory with the array
+    sub(1, 4) = -1;
+    CHECK(arr(3, 4, 3) == -1);
+    arr(3, 4, 3) = value(3, 4, 3);
+
+    auto t = sub.transpose();
+    REQUIRE(t.dims() == std::array<size_t, 2>{5, 2});
+    for (auto [j, i] : counter(5, 2)) { CHECK(t(j, i) == sub(i, j)); }
+    REQUIRE_THROWS(t.at(5, 0));
+
+    auto permuted = arr.view().transpose({2, 0, 1});
+    REQUIRE(permuted.dims() == std::array<size_t, 3>{6, 4, 5});
+    CHECK(permuted(5, 3, 4) == arr(3, 4, 5));
+
+    // iteration in row-major order of the view
+    std::vector<int> visited(t.begin(), t.end());
+    REQUIRE(visited.size() == 10);
+    for (size_t n = 0; n < visited.size(); ++n) { CHECK(visited[n] == value(1 + (n % 2) * 2, n / 2, 3)); }
+
+    auto copied = t.copy();
+    REQUIRE(copied.dims() == t.dims());
+    CHECK(std::equal(copied.begin(), copied.end(), visited.begin()));
+
+    auto flat = arr.view().reshape(20, 6);
+    CHECK(flat(7, 2) == 7 * 6 + 2);
+    REQUIRE_THROWS(flat.reshape(7, 7));
+    REQUIRE_THROWS(sub.reshape(10));
+    REQUIRE_THROWS(arr.slice(4, ndall, ndall));
+
+    auto empty = arr.slice(ndslice{2, 2}, ndall, ndall);
+    CHECK(empty.empty());
+    CHECK(empty.begin() == empty.end());
+
+    // external memory
+    std::vector<float> external(12);
+    ndarray_view ext{std::span{external}, std::array<size_t, 2>{3, 4}};
+    ext(2, 1) = 1.5f;
+    CHECK(external[9] == 1.5f);
+    REQUIRE_THROWS(ndarray_view{std::span{external}, std::array<size_t, 2>{4, 4}});
+
+    ndarray_view<float const, 2> const_view = ext;
+    CHECK(const_view.slice(ndall, 1)(2) == 1.5f);
+}
+
+/**
+ * Fills fresh storage with a byte pattern, thus skipped initialization is observable
+ */
+template <typename Ty_>
+struct poisoning_allocator : std::allocator<Ty_> {
+    static constexpr int pattern = int(0xCDCDCDCD);
+
+    poisoning_allocator() = default;
+    template <typename OTy_>
+    poisoning_allocator(poisoning_allocator<OTy_> const&) noexcept {}
+
+    Ty_* allocate(size_t n) {
+        auto p = std::allocator<Ty_>::allocate(n);
+        std::memset(static_cast<void*>(p), 0xCD, n * sizeof(Ty_));
+        return p;
+    }
+};
+
+template <typename Arr_>
+concept uninitialized_reshapable = requires(Arr_& arr) { arr.reshape(typename Arr_::dimension_type{}, uninitialized); };
+
+TEST_CASE("ndarray storage") {
+    aligned_ndarray<float, 2> aligned(3, 5);
+    CHECK(reinterpret_cast<uintptr_t>(aligned.data()) % 64 == 0);
+    aligned.reshape({100, 100});
+    CHECK(reinterpret_cast<uintptr_t>(aligned.data()) % 64 == 0);
+
+    ndarray<int, 2, aligned_allocator<int, 4096>> paged(10, 10);
+    CHECK(reinterpret_cast<uintptr_t>(paged.data()) % 4096 == 0);
+
+    // regular reshape value-initializes new elements
+    ndarray<int, 1> arr(10);
+    for (auto& v : arr) { v = 7; }
+    arr.reshape(5), arr.reshape(10);
+    CHECK(std::count(arr.begin(), arr.end(), 0) == 5);
+    static_assert(std::is_same_v<decltype(arr.vector()), std::vector<int>&>);
+    static_assert(!uninitialized_reshapable<ndarray<int, 1>>, "plain std::vector storage can't skip initialization");
+    static_assert(uninitialized_reshapable<aligned_ndarray<int, 1>>);
+
+    // uninitialized one leaves new trivial elements as allocated, and keeps old values
+    ndarray<int, 1, poisoning_allocator<int>> poisoned(4);
+    for (auto& v : poisoned) { v = 7; }
+    poisoned.reshape({1000}, uninitialized);
+    CHECK(poisoned.size() == 1000);
+    CHECK(std::count(poisoned.begin(), poisoned.begin() + 4, 7) == 4);
+    CHECK(std::count(poisoned.begin() + 4, poisoned.end(), poisoning_allocator<int>::pattern) == 996);
+
+    poisoned.reshape({4}), poisoned.reshape({8});
+    CHECK(std::count(poisoned.begin() + 4, poisoned.end(), 0) == 4);
+
+    aligned_ndarray<std::string, 1> strings(3);
+    strings.reshape({5}, uninitialized);
+    CHECK(strings(4).empty());
+}
+
+TEST_CASE("ndarray expressions") {
+    ndarray<int, 2> a(3, 4), b(3, 4), c;
+    ndarray<int, 1> bias(4);
+    std::iota(a.begin(), a.end(), 0);
+    std::iota(b.begin(), b.end(), 10);
+    std::iota(bias.begin(), bias.end(), 100);
+
+    c = a * b + bias;
+    REQUIRE(c.dims() == a.dims());
+    for (auto [i, j] : counter(3, 4)) { CHECK(c(i, j) == a(i, j) * b(i, j) + bias(j)); }
+
+    // column vector broadcasts along rows
+    ndarray<int, 2> column(3, 1);
+    std::iota(column.begin(), column.end(), 1);
+    ndarray<int, 2> d = -(a - column) * 2 + ndmap([](int x, int y) { return x % y; }, b, 3);
+    for (auto [i, j] : counter(3, 4)) { CHECK(d(i, j) == -(a(i, j) - column(i, 0)) * 2 + b(i, j) % 3); }
+
+    // in place, and into non-contiguous view
+    auto prev = a;
+    a = a + 1;
+    for (auto [x, y] : zip(a, prev)) { CHECK(x == y + 1); }
+
+    ndarray<int, 2> big(6, 8);
+    auto window = big.slice(ndslice{0, 6, 2}, ndslice{4, 8});
+    window.assign(a * 10);
+    for (auto [i, j] : counter(3, 4)) { CHECK(big(i * 2, j + 4) == a(i, j) * 10); }
+    REQUIRE_THROWS(big.slice(ndall, ndall).assign(a * 10));
+    REQUIRE_THROWS((a + ndarray<int, 1>(3)).eval());
+
+    ndarray<float, 2> x(97, 131), y;
+    std::iota(x.begin(), x.end(), 0.f);
+    evaluate(std::execution::par, y, x * 0.5f + x.transpose().transpose());
+    CHECK(y.dims() == x.dims());
+    for (auto [p, q] : zip(y, x)) { CHECK(p == q * 0.5f + q); }
+
+    ndarray<float, 2> z(131, 97);
+    evaluate(std::execution::par, z, x.transpose() - 1.f, 7);
+    for (auto [i, j] : counter(131, 97)) { CHECK(z(i, j) == x(j, i) - 1.f); }
+
+    // destination which is also an operand, but resized by broadcasting or read through other elements
+    ndarray<int, 2> row(1, 4), col(3, 1);
+    row.assign({1, 2, 3, 4}), col.assign({10, 20, 30});
+    row = row + col;
+    REQUIRE(row.dims() == std::array<size_t, 2>{3, 4});
+    for (auto [i, j] : counter(3, 4)) { CHECK(row(i, j) == int(j + 1) + col(i, 0)); }
+
+    auto shifted = row;
+    shifted.slice(ndslice{1, 3}, ndall).assign(shifted.slice(ndslice{0, 2}, ndall) * 1);
+    for (auto [i, j] : counter(2, 4)) { CHECK(shifted(i + 1, j) == row(i, j)); }
+
+    evaluate(std::execution::par, z, z.transpose().transpose() + x.transpose());
+    for (auto [i, j] : counter(131, 97)) { CHECK(z(i, j) == 2 * x(j, i) - 1.f); }
+    evaluate(std::execution::par, x, x.slice(ndall, ndslice{0, 1}) + 0.f);
+    REQUIRE(x.dims() == std::array<size_t, 2>{97, 1});
+    for (size_t i = 0; i < 97; ++i) { CHECK(x(i, 0) == float(i * 131)); }
+
+    // reductions
+    ndarray<int, 2> m(3, 4);
+    m.assign({5, 2, 7, 2,
+              1, 8, 0, 9,
+              4, 4, 6, 3});
+    CHECK(sum(m) == 51);
+    CHECK(sum(m * 2) == 102);
+    CHECK(min(m) == 0);
+    CHECK(argmin(m) == std::array<size_t, 2>{1, 2});
+
+    auto rows = sum(m, 1);
+    CHECK(std::ranges::equal(rows, std::vector{16, 18, 17}));
+    auto cols = min(m, 0);
+    CHECK(std::ranges::equal(cols, std::vector{1, 2, 0, 2}));
+    auto row_argmin = argmin(m, 1);
+    CHECK(std::ranges::equal(row_argmin, std::vector<size_t>{1, 2, 3}));
+    auto col_argmin = argmin(m - column, 0);
+    CHECK(std::ranges::equal(col_argmin, std::vector<size_t>{1, 0, 1, 2}));
+}
+
+TEMPLATE_TEST_CASE("ndarray layouts", "", layout_col_major, layout_tiled<8>, layout_tiled<4>) {
+    ndarray<int, 2> src(21, 37);
+    std::iota(src.begin(), src.end(), 0);
+
+    auto dst = copy_layout<TestType>(src);
+    REQUIRE(dst.dims() == src.dims());
+    for (auto const& idx : counter(src.dims())) { CHECK(dst[idx] == src[idx]); }
+
+    // every element has its own storage slot
+    std::vector<int> stored(dst.begin(), dst.end());
+    std::ranges::sort(stored);
+    CHECK(std::ranges::equal(stored, src.vector()));
+
+    ndarray<int, 2, std::allocator<int>, TestType> assigned(2, 3);
+    assigned.assign({0, 1, 2, 3, 4, 5});
+    CHECK(assigned(1, 0) == 3);
+    CHECK(assigned.at(0, 2) == 2);
+    REQUIRE_THROWS(assigned.at(2, 0));
+
+    auto back = copy_layout<layout_row_major>(dst);
+    CHECK(back == src);
+
+    auto transposed = transpose_copy(dst);
+    REQUIRE(transposed.dims() == std::array<size_t, 2>{37, 21});
+    for (auto [i, j] : counter(21, 37)) { CHECK(transposed(j, i) == src(i, j)); }
+}
+
+TEST_CASE("ndarray layouts strided view") {
+    ndarray<int, 3, std::allocator<int>, layout_col_major> arr(2, 3, 4);
+    for (auto const& idx : counter(arr.dims())) { arr[idx] = int(idx[0] * 100 + idx[1] * 10 + idx[2]); }
+    CHECK(arr.vector()[1] == 100);
+
+    auto view = arr.view();
+    CHECK(view.is_contiguous() == false);
+    for (auto const& idx : counter(arr.dims())) { CHECK(view[idx] == arr[idx]); }
+
+    ndarray<int, 3> sum = arr + 1;
+    for (auto const& idx : counter(arr.dims())) { CHECK(sum[idx] == arr[idx] + 1); }
+}
+
+TEST_CASE("ndarray file") {
+    auto path = std::filesystem::temp_directory_path() / "kangsw-ndarray-file-test.bin";
+
+    ndarray<double, 3> arr(4, 5, 6);
+    std::iota(arr.begin(), arr.end(), 0.0);
+    save(path, arr);
+
+    {
+        auto mapped = ndarray_view<double const, 3>::map(path);
+        CHECK(mapped.dims() == arr.dims());
+        CHECK(reinterpret_cast<uintptr_t>(mapped.data()) % 64 == 0);
+        CHECK(std::ranges::equal(mapped, arr));
+
+        REQUIRE_THROWS(ndarray_view<float const, 3>::map(path));
+        REQUIRE_THROWS(ndarray_view<double const, 2>::map(path));
+    }
+
+    SECTION("strided view") {
+        save(path, arr.transpose());
+        auto mapped = ndarray_view<double const, 3>::map(path);
+        CHECK(mapped.dims() == arr.transpose().dims());
+        CHECK(std::ranges::equal(mapped, arr.transpose()));
+    }
+
+    SECTION("streaming writer") {
+        {
+            ndarray_writer<int, 2> writer{path, {1000, 3}};
+            for (int i = 0; i < 1000; ++i) {
+                int row[] = {i, i * 2, i * 3};
+                writer.write(row);
+            }
+        }
+
+        auto mapped = ndarray_view<int, 2>::map(path);
+        CHECK(mapped(999, 2) == 2997);
+        mapped(0, 0) = 42;
+        CHECK(ndarray_view<int const, 2>::map(path)(0, 0) == 42);
+    }
+
+    SECTION("incomplete file") {
+        {
+            ndarray_writer<int, 1> writer{path, {10}};
+            writer.write(1);
+            REQUIRE_THROWS(writer.close());
+        }
+        REQUIRE_THROWS(ndarray_view<int const, 1>::map(path));
+    }
+
+    std::filesystem::remove(path);
+}
+
+// throws on the budget-th copy or move; negative budget never throws
+struct fragile {
+    static inline int budget = -1;
+
+    fragile() = default;
+    fragile(fragile const&) { _spend(); }
+    fragile(fragile&&) { _spend(); }
+    fragile& operator=(fragile const&) = default;
+
+    static void _spend() {
+        if (budget >= 0 && budget-- == 0) { throw std::runtime_error("fragile"); }
+    }
+};
+
+TEST_CASE("soa_vector") {
+    soa_vector<float, double, std::string> soa;
+    for (int i = 0; i < 100; ++i) { soa.push_back(float(i), i * 2.0, std::to_string(i)); }
+    REQUIRE(soa.size() == 100);
+
+    auto [f, d, str] = soa[42];
+    CHECK(f == 42.f);
+    CHECK(d == 84.0);
+    CHECK(str == "42");
+    REQUIRE_THROWS_AS(soa.at(100), std::out_of_range);
+
+    CHECK(reinterpret_cast<uintptr_t>(soa.field<0>().data()) % 64 == 0);
+    CHECK(reinterpret_cast<uintptr_t>(soa.field<1>().data()) % 64 == 0);
+
+    // iterating subset of fields
+    for (auto [value, scale] : soa.fields<0, 1>()) { value *= float(scale); }
+    CHECK(soa.field<0>()[3] == 18.f);
+
+    size_t count = 0;
+    for (auto [value, scale, name] : soa) { count += name == std::to_string(int(scale / 2)); }
+    CHECK(count == 100);
+
+    soa.pop_back();
+    CHECK(std::get<2>(soa.back()) == "98");
+
+    soa.resize(200);
+    CHECK(std::get<0>(soa[150]) == 0.f);
+    CHECK(std::get<2>(soa[150]).empty());
+
+    auto const& const_soa = soa;
+    CHECK(std::ranges::equal(const_soa.field<1>().subspan(0, 3), std::vector{0.0, 2.0, 4.0}));
+
+    soa.clear();
+    CHECK(soa.empty());
+
+    // failure of one field rolls back the others
+    soa_vector<int, fragile> fragiles;
+    fragiles.reserve(16);
+    fragiles.push_back(1, {});
+
+    fragile::budget = 0;
+    REQUIRE_THROWS_AS(fragiles.push_back(2, {}), std::runtime_error);
+    CHECK(fragiles.size() == 1);
+    CHECK(fragiles.field<1>().size() == 1);
+
+    fragile::budget = 3;
+    REQUIRE_THROWS_AS(fragiles.resize(10), std::runtime_error);
+    CHECK(fragiles.size() == 1);
+    CHECK(fragiles.field<1>().size() == 1);
+    fragile::budget = -1;
+}
+
 TEST_CASE("circular_queue") {
     circular_queue<int> s1{256};
     auto s2 = s1;
@@ -82,4 +433,91 @@ TEST_CASE("circular_queue") {
         CHECK(std::equal(cnt2.begin(), cnt2.end(), s.begin()));
     }
 }
+
+TEMPLATE_TEST_CASE("circular_queue batch operations", "", int, std::string) {
+    auto gen = [](int i) {
+        if constexpr (std::is_same_v<TestType, int>) { return i; }
+        else { return std::to_string(i); }
+    };
+
+    std::vector<TestType> src;
+    for (auto i : counter(100)) { src.push_back(gen(i)); }
+
+    circular_queue<TestType> s{100};
+    circular_queue<TestType, true> p{100};
+    CHECK(p.capacity() == 127);
+
+    // wrap content around the buffer end
+    s.push_n(src.begin(), 60), s.pop_n(50);
+    p.push_n(src.begin(), 120 - 60), p.pop_n(50);
+    s.push_n(src.begin(), 80);
+    p.push_n(src.begin(), 100);
+    REQUIRE(s.size() == 90);
+    REQUIRE(p.size() == 110);
+    REQUIRE_THROWS(s.push_n(src.begin(), 20));
+
+    auto [first, second] = s.as_spans();
+    CHECK(first.size() + second.size() == s.size());
+    CHECK(second.empty() == false);
+    CHECK(std::equal(s.begin(), s.begin() + first.size(), first.begin()));
+    CHECK(std::equal(s.begin() + first.size(), s.end(), second.begin()));
+    CHECK(p.end() - p.begin() == 110);
+    CHECK(*(p.begin() + 10) == src[0]);
+    CHECK(*(p.end() - 1) == src[99]);
+
+    std::vector<TestType> dst(95);
+    auto it = s.pop_n(dst.begin(), 10);
+    CHECK(s.size() == 80);
+    CHECK(std::equal(dst.begin(), it, src.begin() + 50));
+    it = s.pop_n(it, 80);
+    CHECK(s.empty());
+    CHECK(std::equal(dst.begin() + 10, it, src.begin()));
+
+    p.reserve_shrink(50);
+    CHECK(p.capacity() == 63);
+    CHECK(p.size() == 63);
+    CHECK(p.front() == src[50]);
+    CHECK(*(p.begin() + 10) == src[0]);
+
+    size_t n_visit = 0;
+    p.for_each([&](auto&) { ++n_visit; });
+    CHECK(n_visit == 63);
+
+    auto copied = p;
+    CHECK(std::equal(copied.begin(), copied.end(), p.begin(), p.end()));
+}
+
+TEST_CASE("circular_queue growth") {
+    circular_queue<std::string> s{4, {.grow = true, .shrink_watermark = 0.25, .min_capacity = 4}};
+
+    // wrap before first growth, to check relocation of both segments
+    for (auto i : counter(3)) { s.push(std::to_string(i)); }
+    s.pop_n(2);
+    for (auto i : counter(1000)) { s.push(std::to_string(i + 3)); }
+    s.push(s.front());
+
+    CHECK(s.size() == 1002);
+    CHECK(s.capacity() >= 1002);
+    CHECK(s.back() == "2");
+    for (size_t i = 0; i < 1001; ++i) { CHECK(*(s.begin() + i) == std::to_string(i + 2)); }
+
+    std::vector<int> src(600, 1);
+    circular_queue<int> n{16, {.grow = true}};
+    n.push_n(src.begin(), src.size());
+    CHECK(n.size() == 600);
+
+    // batch source aliasing the queue itself survives relocation
+    circular_queue<std::string> a{4, {.grow = true}};
+    for (auto i : counter(4)) { a.push(std::to_string(i)); }
+    a.push_n(a.as_spans().first.data(), 4);
+    CHECK(a.size() == 8);
+    for (size_t i = 0; i < 8; ++i) { CHECK(*(a.begin() + i) == std::to_string(i % 4)); }
+
+    s.pop_n(900);
+    CHECK(s.capacity() < 1002);
+    CHECK(s.front() == "902");
+
+    while (!s.empty()) { s.pop(); }
+    CHECK(s.capacity() == 4);
+}
 } // namespace kangsw::container_test
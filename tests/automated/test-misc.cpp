@@ -7,9 +7,17 @@
  * ----------------------------------------------------------------------------
  */
 #include <algorithm>
+#include <atomic>
+#include <execution>
+#include <numeric>
+#include <ranges>
+#include <set>
+#include <vector>
 
 #define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch.hpp"
+#include "kangsw/helpers/counter.hxx"
+#include "kangsw/helpers/for_each.hxx"
 #include "kangsw/helpers/hash_index.hxx"
 #include "kangsw/helpers/infix.hxx"
 #include "kangsw/helpers/misc.hxx"
@@ -123,6 +131,58 @@ TEST_CASE("packed tuple test") {
     cfg = ff;
 }
 
+TEST_CASE("packed tuple unchecked") {
+    std::vector<float> a(1000, 1.f), b(1000, 2.f);
+    for (auto [x, y] : zip_unchecked(a, b)) { x += y * 0.5f; }
+    CHECK(std::ranges::count(a, 2.f) == 1000);
+
+    // lengths are checked once, on construction
+    auto c = {1, 2, 3};
+    REQUIRE_THROWS_AS(zip_unchecked(a, c), std::invalid_argument);
+
+    auto zipped = zip_unchecked(a, b);
+    CHECK(zipped.end() - zipped.begin() == 1000);
+}
+
+TEST_CASE("packed tuple random access") {
+    std::vector<int> a(1000);
+    std::vector<double> b(1000);
+    std::iota(a.begin(), a.end(), 0);
+
+    auto zipped = zip(a, b);
+    using zip_type = decltype(zipped);
+    static_assert(std::ranges::random_access_range<zip_type>);
+    static_assert(std::ranges::sized_range<zip_type>);
+    static_assert(std::sortable<std::ranges::iterator_t<zip_type>>);
+    CHECK(zipped.size() == 1000);
+    CHECK(zipped.begin() < zipped.end());
+    CHECK(std::is_gt(zipped.end() <=> zipped.begin()));
+
+    auto sub = zipped.subrange(100, 200);
+    CHECK(sub.size() == 100);
+    CHECK(std::get<0>(sub.front()) == 100);
+    CHECK(std::get<0>(sub.back()) == 199);
+    REQUIRE_THROWS_AS(zipped.subrange(200, 1001), std::out_of_range);
+
+    // partitions are split by jumping iterators
+    for_each_partition(
+      std::execution::par, zipped.begin(), zipped.end(),
+      [](auto&& elem) { std::get<1>(elem) = std::get<0>(elem) * 0.5; }, 7);
+    CHECK(b[999] == 499.5);
+
+    std::ranges::sort(zipped, std::greater{}, [](auto const& e) { return std::get<0>(e); });
+    CHECK(a.front() == 999);
+    CHECK(b.front() == 499.5);
+
+    // ranges with distinct sentinel type
+    int visited = 0;
+    for (auto [i, x] : zip(std::views::iota(0) | std::views::take(5), std::views::counted(a.begin(), 5))) { visited += x == 999 - i; }
+    CHECK(visited == 5);
+
+    auto c = {1, 2, 3};
+    REQUIRE_THROWS_AS(zip(a, c).size(), std::invalid_argument);
+}
+
 TEST_CASE("constexpr hashing") {
     switch (fnv1a("hell, world!")) {
     case hash_index("hell, world!"):
@@ -177,6 +237,31 @@ TEST_CASE("safe string table") {
     }
 }
 
+TEST_CASE("compile-time format") {
+    CHECK(format("%d|%5d|%-5d|%05d|%+d|%.3d", 42, -42, 42, -42, 42, 7) == "42|  -42|42   |-0042|+42|007");
+    CHECK(format("%llu %x %#X %o", ~0ull, 255, 255, 8) == "18446744073709551615 ff 0XFF 10");
+    CHECK(format("%.3f %10.2e %g %G", 3.14159, -1234.5, 0.0001, 1e20) == "3.142  -1.23e+03 0.0001 1E+20");
+    CHECK(format("%s|%6s|%-6s|%.2s|%c", "a", std::string{"b"}, std::string_view{"c"}, "def", 'g') == "a|     b|c     |de|g");
+    CHECK(format("100%% of %d%%", 5) == "100% of 5%");
+    CHECK(format("%f", 1e300).size() == 308);
+
+    std::string line = "log: ";
+    line.reserve(128);
+    auto capacity = line.capacity();
+    append_to(line, "%s=%d", "key", 3);
+    CHECK(line == "log: key=3");
+    CHECK(line.capacity() == capacity);
+
+    char buffer[8];
+    CHECK(format_to(buffer, "%s-%d", "abcdef", 12345) == 12);
+    CHECK(std::string_view(buffer, 8) == "abcdef-1");
+
+    format_buffer<8> small;
+    format_to(small, "%d", 1234);
+    format_to(small, "%d", 56789);
+    CHECK(small.view() == "123456789");
+}
+
 struct owner {
     inline static int callcnt_ = 0;
     owner& operator=(owner&&) = default;
@@ -196,11 +281,61 @@ TEST_CASE("ownership") {
     REQUIRE(owner::callcnt_ == 1);
 }
 
+TEST_CASE("sort index") {
+    std::vector<size_t> indexes(5000), scratch(5000);
+    auto expect_sorted = [&](auto const& pivot) {
+        for (size_t i = 1; i < pivot.size(); ++i) {
+            auto l = indexes[i - 1], r = indexes[i];
+            REQUIRE((pivot[l] < pivot[r] || (!(pivot[r] < pivot[l]) && l < r)));
+        }
+    };
+
+    std::vector<int> ints(5000);
+    std::vector<double> reals(5000);
+    std::vector<std::string> strs(5000);
+    for (size_t i = 0; i < ints.size(); ++i) {
+        ints[i] = int(i * 7919 % 1000) - 500;
+        reals[i] = ints[i] * -0.25;
+        strs[i] = std::to_string(ints[i]);
+    }
+
+    SECTION("comparison") {
+        sort_index(ints, indexes);
+        expect_sorted(ints);
+        sort_index(strs, indexes, scratch);
+        expect_sorted(strs);
+    }
+
+    SECTION("radix") {
+        sort_index(ints, indexes, scratch);
+        expect_sorted(ints);
+        sort_index(reals, indexes, scratch);
+        expect_sorted(reals);
+        CHECK(sort_index(reals) == indexes);
+
+        std::vector<uint8_t> same(100, 3);
+        sort_index(same, indexes, scratch);
+        CHECK(std::is_sorted(indexes.begin(), indexes.begin() + 100));
+    }
+
+    REQUIRE_THROWS_AS(sort_index(ints, std::span{indexes}.first(10)), std::invalid_argument);
+
+    SECTION("apply permutation") {
+        sort_index(ints, indexes, scratch);
+        auto perm = indexes;
+        apply_permutation(indexes, ints, reals, strs);
+        CHECK(indexes == perm);
+        CHECK(std::ranges::is_sorted(ints));
+        CHECK(std::ranges::is_sorted(reals, std::greater{}));
+        for (size_t i = 0; i < ints.size(); ++i) { REQUIRE(strs[i] == std::to_string(ints[i])); }
+    }
+}
+
 TEST_CASE("n-dim counter", "[.]") {
     constexpr size_t I = 150, J = 100, K = 100;
    static bool set[I][J][K] = {};
 
-    for (auto& index : counter(I, J, K)) {
+    for (auto const& index : counter(I, J, K)) {
         set[index[0]][index[1]][index[2]] = true;
     }
 
@@ -217,7 +352,7 @@ TEST_CASE("n-dim counter", "[.]") {
     int g = 0;
     BENCHMARK("3D Counter bench") {
         k = 0;
-        for (auto& c : counter(I, J, K)) {
+        for (auto const& c : counter(I, J, K)) {
             k = g++;
         }
     };
@@ -236,4 +371,146 @@ TEST_CASE("n-dim counter", "[.]") {
 
     REQUIRE(successful);
 }
+
+TEST_CASE("n-dim counter random access") {
+    auto range = counter(7, 5, 3);
+    REQUIRE(range.size() == 105);
+    static_assert(std::random_access_iterator<decltype(range.begin())>);
+    static_assert(std::ranges::random_access_range<decltype(range)>);
+
+    size_t offset = 0;
+    for (auto const& index : range) {
+        CHECK(range.begin()[offset] == index);
+        CHECK(*(range.end() - (105 - offset)) == index);
+        CHECK(size_t(index[0] * 15 + index[1] * 3 + index[2]) == offset++);
+    }
+
+    auto it = range.end();
+    for (size_t i = 105; i-- > 0;) { CHECK((--it).offset() == i); }
+    CHECK(it == range.begin());
+
+    CHECK(counter(std::array<size_t, 2>{4, 0}).size() == 0);
+    CHECK(counter(std::array<size_t, 2>{0, 4}).begin() == counter(std::array<size_t, 2>{0, 4}).end());
+
+    SECTION("chunks") {
+        std::vector<int> visit(range.size());
+        size_t num_chunks = 0;
+        for (auto chunk : range.chunks(8)) {
+            CHECK(chunk.size() >= 105 / 8);
+            CHECK(chunk.size() <= 105 / 8 + 1);
+            for (auto const& index : chunk) { ++visit[index[0] * 15 + index[1] * 3 + index[2]]; }
+            ++num_chunks;
+        }
+
+        CHECK(num_chunks == 8);
+        CHECK(std::ranges::count(visit, 1) == 105);
+    }
+
+    SECTION("parallel") {
+        std::vector<int> visit(range.size());
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](auto const& index) {
+            ++visit[index[0] * 15 + index[1] * 3 + index[2]];
+        });
+        CHECK(std::ranges::count(visit, 1) == 105);
+    }
+}
+
+TEST_CASE("n-dim counter traversal") {
+    auto range = counter(13, 7, 5);
+    std::vector<std::array<int, 3>> expected(range.begin(), range.end());
+
+    auto visits_all = [&](auto&& seq) {
+        std::vector<std::array<int, 3>> visited(seq.begin(), seq.end());
+        std::ranges::sort(visited);
+        return visited == expected;
+    };
+
+    SECTION("tiled") {
+        CHECK(visits_all(range.traverse(traversal::tiled{4, 3, 2})));
+        CHECK(visits_all(range.traverse(traversal::tiled{100, 1, 100})));
+
+        auto tiles = counter(4, 6).traverse(traversal::tiled{2, 4});
+        std::vector<std::array<int, 2>> order(tiles.begin(), tiles.end());
+        CHECK(order[3] == std::array{0, 3});
+        CHECK(order[4] == std::array{1, 0});
+        CHECK(order[8] == std::array{0, 4});
+    }
+
+    SECTION("morton") {
+        CHECK(visits_all(range.traverse(traversal::morton)));
+
+        auto z = counter(4, 4).traverse(traversal::morton);
+        std::vector<std::array<int, 2>> order(z.begin(), z.end());
+        CHECK(order[1] == std::array{0, 1});
+        CHECK(order[2] == std::array{1, 0});
+        CHECK(order[4] == std::array{0, 2});
+    }
+
+    SECTION("hilbert") {
+        for (auto [h, w] : counter(9, 9)) {
+            auto curve = counter(h, w).traverse(traversal::hilbert);
+            std::vector<std::array<int, 2>> visited(curve.begin(), curve.end());
+            CHECK(visited.size() == size_t(h * w));
+            CHECK(std::set(visited.begin(), visited.end()).size() == visited.size());
+        }
+
+        auto curve = counter(16, 16).traverse(traversal::hilbert);
+        std::vector<std::array<int, 2>> order(curve.begin(), curve.end());
+        for (size_t i = 1; i < order.size(); ++i) {
+            CHECK(std::abs(order[i][0] - order[i - 1][0]) + std::abs(order[i][1] - order[i - 1][1]) == 1);
+        }
+    }
+
+    SECTION("inner run") {
+        auto runs = range.traverse(traversal::inner_run);
+        CHECK(runs.size() == 13 * 7);
+
+        // catch assertions are not thread safe, thus only count malformed runs inside
+        std::vector<int> visit(range.size());
+        std::atomic_int num_malformed = 0;
+        std::for_each(std::execution::par, runs.begin(), runs.end(), [&](auto run) {
+            if (run.first[2] != 0 || run.length != 5) { ++num_malformed; }
+            auto* row = &visit[run.first[0] * 35 + run.first[1] * 5];
+            for (auto k : run) { ++row[k]; }
+        });
+        CHECK(num_malformed == 0);
+        CHECK(std::ranges::count(visit, 1) == range.size());
+
+        size_t num_runs = 0;
+        for (auto chunk : runs.chunks(4)) { num_runs += chunk.size(); }
+        CHECK(num_runs == runs.size());
+        CHECK(runs.begin()[8].first == std::array{1, 1, 0});
+    }
+
+    CHECK(counter(0, 5).traverse(traversal::morton).begin() == counter(0, 5).traverse(traversal::morton).end());
+    CHECK(counter(3, 0).traverse(traversal::inner_run).size() == 0);
+}
+
+TEST_CASE("recurse_for_each") {
+    struct node {
+        int id;
+        std::vector<node> children;
+    };
+
+    // 0 -> (1 -> (2, 3), 4 -> (5))
+    node root{0, {{1, {{2, {}}, {3, {}}}}, {4, {{5, {}}}}}};
+    auto expand = [](node const* parent, auto&& emplace) {
+        for (auto it = parent->children.rbegin(); it != parent->children.rend(); ++it) { emplace(&*it); }
+    };
+
+    std::vector<int> order;
+    recurse_for_each<node const*>(&root, [&](node const* parent, auto&& emplace) { order.push_back(parent->id), expand(parent, emplace); });
+    CHECK(order == std::vector{0, 1, 2, 3, 4, 5});
+
+    order.clear();
+    std::vector<size_t> depths;
+    recurse_stack<node const&> stack;
+    recurse_for_each<node const&>(
+      root, [&](node const& parent, auto&& emplace) { expand(&parent, [&](node const* child) { emplace(*child); }); },
+      recurse::postorder, [&](node const& visited, size_t depth) { order.push_back(visited.id), depths.push_back(depth); },
+      &stack);
+    CHECK(order == std::vector{2, 3, 1, 5, 4, 0});
+    CHECK(depths == std::vector<size_t>{2, 2, 1, 2, 1, 0});
+    CHECK(stack.capacity() > 0);
+}
 } // namespace kangsw::misc_test
\ No newline at end of file
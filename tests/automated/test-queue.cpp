@@ -6,11 +6,13 @@
  * this stuff is worth it, you can buy me a beer in return.      Seungwoo Kang.
  * ----------------------------------------------------------------------------
  */
+#include <stdexcept>
 #include <string>
 #include <thread>
 #define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch.hpp"
 #include "kangsw/thread/atomic_queue.hxx"
+#include "kangsw/thread/spsc_queue.hxx"
 #include "kangsw/helpers/misc.hxx"
 
 namespace kangsw::container_test::queue {
@@ -118,4 +120,92 @@ TEST_CASE("Queue async operations", "[lock_free_queue]") {
     CHECK(zero_cnt == 0);
     CHECK((destinations.size() - not_one_count) == 0);
 } // namespace kangsw::container_test::queue
-} // namespace kangsw::container_test::queue
\ No newline at end of file
+
+TEMPLATE_TEST_CASE("SPSC queue async operations", "[lock_free_queue]", size_t, std::string) {
+    auto gen = [](size_t i) {
+        if constexpr (std::is_same_v<TestType, size_t>) { return i; }
+        else { return std::to_string(i); }
+    };
+
+    const size_t num_case = 1 << 18;
+    spsc_queue<TestType> queue{1000};
+    CHECK(queue.capacity() == 1000);
+
+    std::thread producer([&]() {
+        std::vector<TestType> batch;
+        for (size_t i = 0; i < num_case;) {
+            if (i % 3 == 0) {
+                i += queue.try_push(gen(i));
+                continue;
+            }
+
+            batch.clear();
+            for (size_t k = i; k < std::min(num_case, i + 37); ++k) { batch.push_back(gen(k)); }
+            i += queue.try_push_n(batch.begin(), batch.size());
+        }
+    });
+
+    size_t num_fails = 0;
+    std::vector<TestType> popped(64);
+    for (size_t i = 0; i < num_case;) {
+        switch (i % 3) {
+        case 0: {
+            TestType v;
+            if (queue.try_pop(v)) { num_fails += v != gen(i++); }
+            break;
+        }
+
+        case 1: {
+            auto n = queue.try_pop_n(popped.begin(), popped.size());
+            for (size_t k = 0; k < n; ++k) { num_fails += popped[k] != gen(i++); }
+            break;
+        }
+
+        case 2: {
+            size_t n = 0;
+            queue.for_each([&](TestType const& v) { num_fails += v != gen(i + n++); });
+
+            auto end = queue.end();
+            num_fails += static_cast<size_t>(end - queue.begin()) < n;
+            for (auto it = queue.begin(); it != end; ++it) { num_fails += *it != gen(i + (it - queue.begin())); }
+
+            queue.pop_n(n), i += n;
+            break;
+        }
+        }
+    }
+
+    producer.join();
+    CHECK(num_fails == 0);
+    CHECK(queue.empty());
+}
+
+struct tracked {
+    inline static int num_alive = 0;
+    inline static int throw_countdown = -1;
+
+    tracked() { ++num_alive; }
+    tracked(tracked const&) {
+        if (throw_countdown >= 0 && throw_countdown-- == 0) { throw std::runtime_error("copy failed"); }
+        ++num_alive;
+    }
+    ~tracked() { --num_alive; }
+};
+
+TEST_CASE("SPSC queue push_n exception safety", "[lock_free_queue]") {
+    {
+        std::vector<tracked> batch(6);
+        spsc_queue<tracked> queue{8};
+
+        // wrap head around, so that the batch splits into two segments
+        queue.try_push_n(batch.begin(), 6), queue.pop_n(6);
+        REQUIRE(tracked::num_alive == 6);
+
+        tracked::throw_countdown = 4;
+        REQUIRE_THROWS_AS(queue.try_push_n(batch.begin(), 6), std::runtime_error);
+        CHECK(queue.empty());
+        CHECK(tracked::num_alive == 6);
+    }
+    CHECK(tracked::num_alive == 0);
+}
+} // namespace kangsw::container_test::queue
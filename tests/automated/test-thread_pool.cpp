@@ -9,7 +9,15 @@
 #include <array>
 #include <iomanip>
 #include <iostream>
+#include <list>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
 #include <kangsw/helpers/misc.hxx>
+#include <kangsw/thread/parallel.hxx>
+#include <kangsw/thread/spinlock.hxx>
 #include <kangsw/thread/thread_pool.hxx>
 #define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch.hpp"
@@ -165,4 +173,331 @@ TEST_CASE("Timer accuracy test", "[.]") {
     WARN("Num Workers      : " << workers.num_workers());
     REQUIRE(to_micro(min_v) < 500);
 }
+
+TEST_CASE("thread pool error channel") {
+    thread_pool pool{64, 1};
+    atomic_int num_handled = 0;
+    pool.unhandled_exception_handler = [&](std::exception_ptr e) {
+        try {
+            rethrow_exception(e);
+        } catch (std::runtime_error&) {
+            ++num_handled;
+        }
+    };
+
+    // void task can't deliver its exception, thus it goes to the handler.
+    pool.add_task([] { throw std::runtime_error("void"); });
+
+    auto failing = pool.add_task([]() -> int { throw std::runtime_error("int"); });
+    REQUIRE_THROWS_AS(failing->get(), std::runtime_error);
+
+    // then() on already failed task
+    auto chained = failing->then([](int v) { return v * 2; });
+    REQUIRE_THROWS_AS(chained->get(), std::runtime_error);
+
+    // exception goes down the chain, skipping continuations
+    atomic_bool continued = false;
+    auto deferred = pool.add_task([]() -> int {
+                            this_thread::sleep_for(50ms);
+                            throw std::runtime_error("deferred");
+                        })
+                      ->then([&](int v) { return continued = true, v; })
+                      ->then([&] { return continued = true, 1.0; });
+    REQUIRE_THROWS_AS(deferred->get(), std::runtime_error);
+    CHECK(continued == false);
+
+    // worker survives
+    REQUIRE(pool.add_task([] { return 42; })->get() == 42);
+    CHECK(num_handled == 1);
+    CHECK(pool.num_unhandled_exceptions() == 1);
+
+    // reference result
+    int referred = 3;
+    CHECK(&pool.add_task([&]() -> int& { return referred; })->get() == &referred);
+}
+
+struct throwing_copy {
+    explicit throwing_copy(bool fail) : fail(fail) {}
+    throwing_copy(throwing_copy const& o) : fail(o.fail) {
+        if (fail) { throw std::runtime_error("copy failed"); }
+    }
+
+    bool fail;
+};
+
+TEST_CASE("thread pool continuation failure") {
+    thread_pool pool{64, 1};
+
+    // packaging the continuation copies the result, which throws on worker thread
+    atomic_bool release = false;
+    auto first = pool.add_task([&] {
+        while (!release) { this_thread::yield(); }
+        return throwing_copy{true};
+    });
+    atomic_bool continued = false;
+    auto chained = first->then([&](throwing_copy) { return continued = true, 1; });
+    release = true;
+
+    REQUIRE_THROWS_AS(chained->get(), std::runtime_error);
+    CHECK(continued == false);
+    REQUIRE(pool.add_task([] { return 42; })->get() == 42);
+}
+
+TEST_CASE("for_each_partition on thread pool") {
+    thread_pool pool{64, 3};
+
+    SECTION("visits every element once") {
+        vector<atomic_int> visits(10007);
+        atomic_bool valid_partition = true;
+        for_each_partition(
+          pool, kangsw::counter(visits.size()),
+          [&](size_t i, size_t partition) {
+              valid_partition = valid_partition && partition < num_partitions(pool);
+              visits[i].fetch_add(1);
+          },
+          7);
+
+        CHECK(valid_partition);
+        CHECK(std::all_of(visits.begin(), visits.end(), [](auto& v) { return v == 1; }));
+    }
+
+    SECTION("non random access range") {
+        list<int> values(1000);
+        std::iota(values.begin(), values.end(), 0);
+
+        vector<int64_t> partial(num_partitions(pool));
+        for_each_partition(pool, values, [&](int v, size_t partition) { partial[partition] += v; });
+        CHECK(std::reduce(partial.begin(), partial.end()) == 1000 * 999 / 2);
+    }
+
+    SECTION("uneven workload") {
+        // few heavy items at the front would be all given to a single lane by static partition,
+        // while idle lanes steal them here; asserts on the lanes rather than wall clock time.
+        array<atomic_size_t, 4> heavy_lanes;
+        for_each_partition(
+          pool, kangsw::counter(64),
+          [&](int i, size_t lane) {
+              if (i >= 4) { return this_thread::sleep_for(1ms); }
+              heavy_lanes[i] = lane;
+              this_thread::sleep_for(20ms);
+          },
+          1);
+
+        set<size_t> distinct_lanes(heavy_lanes.begin(), heavy_lanes.end());
+        CHECK(distinct_lanes.size() > 1);
+    }
+
+    SECTION("nested and failing") {
+        atomic_int count = 0;
+        for_each_partition(pool, kangsw::counter(8), [&](int) {
+            for_each_partition(pool, kangsw::counter(100), [&](int) { ++count; });
+        });
+        CHECK(count == 800);
+
+        REQUIRE_THROWS_AS(
+          for_each_partition(pool, kangsw::counter(1000), [](int i) { if (i == 500) { throw std::runtime_error("fail"); } }),
+          std::runtime_error);
+    }
+
+    for_each_partition(pool, vector<int>{}, [](int) { FAIL(); });
+}
+
+TEST_CASE("parallel recurse_for_each") {
+    thread_pool pool{64, 3};
+
+    // complete tree of fan-out 4 and depth 8, where children of i are 4i+1 ... 4i+4
+    constexpr size_t num_nodes = (1 << 18) / 3;
+    vector<atomic_int> visits(num_nodes);
+    auto expand = [&](size_t index, auto&& emplace) {
+        visits[index].fetch_add(1);
+        for (size_t child = index * 4 + 1; child <= index * 4 + 4 && child < num_nodes; ++child) { emplace(child); }
+    };
+
+    recurse_stack<size_t> stack;
+    recurse_for_each(pool, size_t{}, expand, 16, &stack);
+    CHECK(std::all_of(visits.begin(), visits.end(), [](auto& v) { return v == 1; }));
+
+    REQUIRE_THROWS_AS(
+      recurse_for_each(pool, size_t{}, [&](size_t index, auto&& emplace) {
+          if (index == 1000) { throw std::runtime_error("fail"); }
+          expand(index, emplace);
+      }),
+      std::runtime_error);
+}
+
+TEMPLATE_TEST_CASE("parallel algorithms", "", thread_pool, std::execution::parallel_policy) {
+    thread_pool pool{64, 3};
+    auto& exec = [&]() -> auto& {
+        if constexpr (std::is_same_v<TestType, thread_pool>) { return pool; }
+        else { return std::execution::par; }
+    }();
+
+    vector<int64_t> values(100003);
+    std::iota(values.begin(), values.end(), 1);
+
+    SECTION("reduce") {
+        CHECK(parallel_reduce(exec, values.begin(), values.end(), int64_t{}) == 100003ll * 100004 / 2);
+        CHECK(parallel_reduce(exec, values.begin(), values.begin(), int64_t{42}) == 42);
+
+        // not commutative, but associative
+        vector<string> words{"a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k"};
+        CHECK(parallel_reduce(exec, words.begin(), words.end(), string{">"}) == ">abcdefghijk");
+
+        // block sums must stay intact while carried into the next block
+        vector<string> prefixes(words.size()), expected(words.size());
+        std::inclusive_scan(words.begin(), words.end(), expected.begin());
+        parallel_inclusive_scan(exec, words.begin(), words.end(), prefixes.begin());
+        CHECK(prefixes == expected);
+
+        list<int> items(1000, 3);
+        CHECK(parallel_transform_reduce(exec, items.begin(), items.end(), int64_t{}, std::plus<>{}, [](int v) { return v * v; }) == 9000);
+    }
+
+    SECTION("inclusive scan") {
+        vector<int64_t> expected(values.size()), scanned(values.size());
+        std::inclusive_scan(values.begin(), values.end(), expected.begin());
+
+        CHECK(parallel_inclusive_scan(exec, values.begin(), values.end(), scanned.begin()) == scanned.end());
+        CHECK(scanned == expected);
+
+        parallel_inclusive_scan(exec, values.begin(), values.end(), values.begin());
+        CHECK(values == expected);
+    }
+
+    SECTION("sort") {
+        mt19937 rand{42};
+        vector<double> items(54321);
+        for (auto& item : items) { item = uniform_real_distribution<>{}(rand); }
+
+        auto expected = items;
+        std::sort(expected.begin(), expected.end(), std::greater<>{});
+        parallel_sort(exec, items.begin(), items.end(), std::greater<>{});
+        CHECK(items == expected);
+    }
+}
+
+TEST_CASE("thread pool per-task overhead", "[.]") {
+    thread_pool pool{4096, std::thread::hardware_concurrency()};
+    constexpr int NUM_TASK = 4096;
+    atomic_int counter = 0;
+
+    BENCHMARK("4096 empty tasks") {
+        counter = 0;
+        for (int i = 0; i < NUM_TASK; ++i) { pool.add_task([&] { counter.fetch_add(1, memory_order_relaxed); }); }
+        while (counter.load() != NUM_TASK) { this_thread::yield(); }
+    };
+
+    // workers mark themselves available shortly after their last task returns
+    auto deadline = chrono::steady_clock::now() + 1s;
+    while (pool.num_available_workers() != pool.num_workers() && chrono::steady_clock::now() < deadline) { this_thread::yield(); }
+
+    INFO("Average wait: " << (chrono::duration<double, micro>(pool.average_wait()).count()) << " us");
+    CHECK(pool.num_available_workers() == pool.num_workers());
+}
+
+TEST_CASE("thread pool contended submission", "[.]") {
+    // every worker updates its statistics per task, while producers and a monitor read them concurrently
+    constexpr size_t NUM_TASK = 1 << 18;
+    size_t num_cores = std::max(1u, thread::hardware_concurrency());
+    printf("%10s %10s %14s  (ns per task)\n", "producers", "workers", "throughput");
+
+    for (size_t num_producers = 1; num_producers <= 2 * num_cores; num_producers *= 2) {
+        thread_pool pool{NUM_TASK, num_cores};
+        size_t const num_tasks = NUM_TASK / num_producers * num_producers;
+        atomic_size_t counter = 0;
+        atomic_bool done = false;
+
+        thread monitor([&] {
+            while (!done.load()) { (void)pool.average_wait(), this_thread::yield(); }
+        });
+
+        auto begin = chrono::steady_clock::now();
+        vector<thread> producers;
+        for (size_t i = 0; i < num_producers; ++i) {
+            producers.emplace_back([&] {
+                for (size_t k = 0; k < NUM_TASK / num_producers; ++k) {
+                    pool.add_task([&] { counter.fetch_add(1, memory_order_relaxed); });
+                }
+            });
+        }
+
+        for (auto& producer : producers) { producer.join(); }
+        while (counter.load() != num_tasks) { this_thread::yield(); }
+        auto elapsed = chrono::steady_clock::now() - begin;
+
+        done = true, monitor.join();
+        printf("%10zu %10zu %14.1f\n", num_producers, num_cores, double(chrono::duration_cast<chrono::nanoseconds>(elapsed).count()) / num_tasks);
+    }
+}
+template <typename Lock_, typename Fn_>
+void run_locked(Lock_& lock, Fn_&& fn) {
+    if constexpr (std::is_same_v<Lock_, mcs_lock>) {
+        mcs_lock::scoped_lock guard{lock};
+        fn();
+    }
+    else {
+        std::lock_guard guard{lock};
+        fn();
+    }
+}
+
+template <typename Lock_>
+chrono::nanoseconds contend_lock(Lock_& lock, size_t num_threads, size_t num_iter, size_t& counter) {
+    vector<thread> threads;
+    atomic_bool go = false;
+    for (size_t i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&] {
+            while (!go.load()) { this_thread::yield(); }
+            for (size_t k = 0; k < num_iter; ++k) { run_locked(lock, [&] { ++counter; }); }
+        });
+    }
+
+    auto begin = chrono::steady_clock::now();
+    go = true;
+    for (auto& th : threads) { th.join(); }
+    return chrono::steady_clock::now() - begin;
+}
+
+TEMPLATE_TEST_CASE("spin locks", "", std::mutex, spinlock, ticket_lock, mcs_lock) {
+    TestType lock;
+    size_t counter = 0;
+    contend_lock(lock, 8, 20000, counter);
+    CHECK(counter == 8 * 20000);
+
+    if constexpr (std::is_same_v<TestType, mcs_lock>) {
+        mcs_lock::node a, b;
+        REQUIRE(lock.try_lock(a));
+        CHECK(!lock.try_lock(b));
+        lock.unlock(a);
+        REQUIRE(lock.try_lock(b));
+        lock.unlock(b);
+    }
+    else {
+        // try_lock on std::mutex already owned by the caller is undefined, thus try from another thread
+        REQUIRE(lock.try_lock());
+        bool acquired = true;
+        std::thread([&] { acquired = lock.try_lock(); }).join();
+        CHECK(!acquired);
+        lock.unlock();
+        REQUIRE(lock.try_lock());
+        lock.unlock();
+    }
+}
+
+TEST_CASE("spin locks contention", "[.]") {
+    constexpr size_t NUM_LOCKS = 1'000'000;
+    printf("%8s %12s %12s %12s %12s  (ns per lock)\n", "threads", "std::mutex", "spinlock", "ticket_lock", "mcs_lock");
+
+    for (size_t num_threads = 1; num_threads <= 2 * thread::hardware_concurrency(); num_threads *= 2) {
+        auto measure = [&]<typename Lock_>(Lock_&& lock) {
+            size_t counter = 0;
+            auto elapsed = contend_lock(lock, num_threads, NUM_LOCKS / num_threads, counter);
+            CHECK(counter == NUM_LOCKS / num_threads * num_threads);
+            return double(elapsed.count()) / counter;
+        };
+
+        printf("%8zu %12.1f %12.1f %12.1f %12.1f\n", num_threads,
+               measure(std::mutex{}), measure(spinlock{}), measure(ticket_lock{}), measure(mcs_lock{}));
+    }
+}
 } // namespace kangsw::thread_pool_test
\ No newline at end of file